@@ -18,12 +18,22 @@
  */
 
 #include "cattle-buffer.h"
+#include <string.h>
 
 /**
  * SECTION:cattle-buffer
  * @short_description: Memory buffer
  *
  * A #CattleBuffer represents a memory buffer.
+ *
+ * Buffers created using cattle_buffer_new() own their storage. Large
+ * programs and inputs can instead be loaded using
+ * cattle_buffer_new_from_file() or cattle_buffer_new_from_bytes(),
+ * which wrap existing data without copying it; such buffers are
+ * read-only.
+ *
+ * A part of a buffer can be used as a buffer of its own, again without
+ * copying anything, by creating a slice using cattle_buffer_new_slice().
  */
 
 /**
@@ -35,10 +45,14 @@
 
 struct _CattleBufferPrivate
 {
-    gboolean  disposed;
+    gboolean      disposed;
+
+    gint8        *data;
+    gulong        size;
 
-    gint8    *data;
-    gulong    size;
+    gboolean      read_only;
+    GBytes       *bytes;  /* Read-only data the buffer wraps, if any */
+    CattleBuffer *parent; /* Buffer this is a slice of, if any */
 };
 
 G_DEFINE_TYPE_WITH_CODE (CattleBuffer, cattle_buffer, G_TYPE_OBJECT,
@@ -59,6 +73,9 @@ cattle_buffer_init (CattleBuffer *self)
 
     priv->data = NULL;
     priv->size = 1;
+    priv->read_only = FALSE;
+    priv->bytes = NULL;
+    priv->parent = NULL;
 
     priv->disposed = FALSE;
 
@@ -107,8 +124,16 @@ cattle_buffer_finalize (GObject *object)
     self = CATTLE_BUFFER (object);
     priv = self->priv;
 
-    /* Free allocated data */
-    if (priv->data != NULL)
+    /* Free allocated data, or release the wrapped data */
+    if (priv->parent != NULL)
+    {
+        g_object_unref (priv->parent);
+    }
+    else if (priv->bytes != NULL)
+    {
+        g_bytes_unref (priv->bytes);
+    }
+    else if (priv->data != NULL)
     {
         g_slice_free1 (priv->size, priv->data);
     }
@@ -133,6 +158,138 @@ cattle_buffer_new (gulong size)
                          NULL);
 }
 
+/**
+ * cattle_buffer_new_from_bytes:
+ * @bytes: (transfer none): data for the buffer
+ *
+ * Create a new memory buffer wrapping @bytes, without copying it.
+ *
+ * The buffer holds a reference to @bytes for as long as it exists,
+ * and is read-only: its contents can't be changed.
+ *
+ * Returns: (transfer full): a new #CattleBuffer
+ */
+CattleBuffer*
+cattle_buffer_new_from_bytes (GBytes *bytes)
+{
+    CattleBuffer        *self;
+    CattleBufferPrivate *priv;
+    gsize                size;
+
+    g_return_val_if_fail (bytes != NULL, NULL);
+
+    /* Don't allocate any storage, the one from @bytes is used */
+    self = cattle_buffer_new (0);
+    priv = self->priv;
+
+    priv->read_only = TRUE;
+    priv->bytes = g_bytes_ref (bytes);
+    priv->data = (gint8 *) g_bytes_get_data (bytes, &size);
+    priv->size = size;
+
+    return self;
+}
+
+/**
+ * cattle_buffer_new_from_file:
+ * @path: (type filename): path of the file to load
+ * @error: (allow-none): return location for a #GError
+ *
+ * Create a new memory buffer containing the file at @path.
+ *
+ * The file is mapped into memory rather than read, so its contents are
+ * only loaded as they're accessed and are never copied: loading a
+ * large program this way is much cheaper than copying it into a
+ * buffer created using cattle_buffer_new().
+ *
+ * The buffer is read-only, and the file should not be modified for
+ * as long as the buffer exists.
+ *
+ * Returns: (transfer full): a new #CattleBuffer, or %NULL on failure
+ */
+CattleBuffer*
+cattle_buffer_new_from_file (const gchar  *path,
+                             GError      **error)
+{
+    CattleBuffer *self;
+    GMappedFile  *file;
+    GBytes       *bytes;
+
+    g_return_val_if_fail (path != NULL, NULL);
+    g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+    file = g_mapped_file_new (path, FALSE, error);
+
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    /* The bytes keep the file mapped for as long as they're alive */
+    bytes = g_mapped_file_get_bytes (file);
+    g_mapped_file_unref (file);
+
+    self = cattle_buffer_new_from_bytes (bytes);
+    g_bytes_unref (bytes);
+
+    return self;
+}
+
+/**
+ * cattle_buffer_new_slice:
+ * @buffer: a #CattleBuffer
+ * @offset: offset of the slice inside @buffer
+ * @size: size of the slice
+ *
+ * Create a new memory buffer containing @size bytes of @buffer,
+ * starting at @offset.
+ *
+ * The slice shares its storage with @buffer, which it holds a
+ * reference to, so creating it doesn't involve any copying: changes to
+ * the contents of either buffer are visible through the other one.
+ * The slice is read-only if @buffer is.
+ *
+ * The slice must fit inside @buffer, that is, @offset plus @size must
+ * not be larger than the size of @buffer.
+ *
+ * Returns: (transfer full): a new #CattleBuffer
+ */
+CattleBuffer*
+cattle_buffer_new_slice (CattleBuffer *buffer,
+                         gulong        offset,
+                         gulong        size)
+{
+    CattleBuffer        *self;
+    CattleBufferPrivate *priv;
+    CattleBufferPrivate *parent_priv;
+
+    g_return_val_if_fail (CATTLE_IS_BUFFER (buffer), NULL);
+
+    parent_priv = buffer->priv;
+    g_return_val_if_fail (!parent_priv->disposed, NULL);
+    g_return_val_if_fail (offset <= parent_priv->size, NULL);
+    g_return_val_if_fail (size <= parent_priv->size - offset, NULL);
+
+    /* Don't allocate any storage, the one from @buffer is used */
+    self = cattle_buffer_new (0);
+    priv = self->priv;
+
+    priv->read_only = parent_priv->read_only;
+    priv->data = parent_priv->data + offset;
+    priv->size = size;
+
+    /* Slices of slices refer directly to the buffer that owns the
+     * storage, so that there are never long chains of references */
+    if (parent_priv->parent != NULL)
+    {
+        buffer = parent_priv->parent;
+    }
+
+    priv->parent = g_object_ref (buffer);
+
+    return self;
+}
+
 /**
  * cattle_buffer_set_contents: (skip)
  * @buffer: a #CattleBuffer
@@ -141,6 +298,8 @@ cattle_buffer_new (gulong size)
  * Set the contents of a memory buffer.
  *
  * The size of @contents is assumed to be the same as the size of @buffer.
+ *
+ * @buffer must not be read-only.
  */
 void
 cattle_buffer_set_contents (CattleBuffer *self,
@@ -167,6 +326,8 @@ cattle_buffer_set_contents (CattleBuffer *self,
  *
  * This method exists mainly for bindings; cattle_buffer_set_contents() is
  * more convenient when writing C code.
+ *
+ * @buffer must not be read-only.
  */
 void
 cattle_buffer_set_contents_full (CattleBuffer *self,
@@ -174,7 +335,6 @@ cattle_buffer_set_contents_full (CattleBuffer *self,
                                  gulong        size)
 {
     CattleBufferPrivate *priv;
-    gulong               i;
 
     g_return_if_fail (CATTLE_IS_BUFFER (self));
     g_return_if_fail (contents != NULL);
@@ -182,15 +342,102 @@ cattle_buffer_set_contents_full (CattleBuffer *self,
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
+    g_return_if_fail (!priv->read_only);
     g_return_if_fail (size <= priv->size);
 
-    /* Copy the data one byte at a time */
-    for (i = 0; i < size; i++)
+    if (size > 0)
     {
-        priv->data[i] = contents[i];
+        memcpy (priv->data, contents, size);
     }
 }
 
+/**
+ * cattle_buffer_get_contents: (skip)
+ * @buffer: a #CattleBuffer
+ * @contents: (out caller-allocates): return location for the contents
+ *
+ * Copy the contents of a memory buffer to @contents.
+ *
+ * @contents must be large enough to hold the whole buffer, as returned
+ * by cattle_buffer_get_size().
+ */
+void
+cattle_buffer_get_contents (CattleBuffer *self,
+                            gint8        *contents)
+{
+    CattleBufferPrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_BUFFER (self));
+    g_return_if_fail (contents != NULL);
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    cattle_buffer_get_contents_full (self, contents, priv->size);
+}
+
+/**
+ * cattle_buffer_get_contents_full: (rename-to cattle_buffer_get_contents)
+ * @buffer: a #CattleBuffer
+ * @contents: (out caller-allocates) (array length=size): return location for the contents
+ * @size: size of @contents
+ *
+ * Copy the first @size bytes of the memory buffer to @contents.
+ *
+ * This method exists mainly for bindings; cattle_buffer_get_contents() is
+ * more convenient when writing C code.
+ */
+void
+cattle_buffer_get_contents_full (CattleBuffer *self,
+                                 gint8        *contents,
+                                 gulong        size)
+{
+    CattleBufferPrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_BUFFER (self));
+    g_return_if_fail (contents != NULL);
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    g_return_if_fail (size <= priv->size);
+
+    if (size > 0)
+    {
+        memcpy (contents, priv->data, size);
+    }
+}
+
+/**
+ * cattle_buffer_peek_contents: (skip)
+ * @buffer: a #CattleBuffer
+ *
+ * Get direct access to the contents of a memory buffer, which is much
+ * faster than calling cattle_buffer_get_value() for every byte.
+ *
+ * The contents must not be changed through the returned pointer, which
+ * is valid for as long as @buffer exists.
+ *
+ * Returns: the contents of @buffer, or %NULL if its size is zero
+ */
+const gint8*
+cattle_buffer_peek_contents (CattleBuffer *self)
+{
+    CattleBufferPrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_BUFFER (self), NULL);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, NULL);
+
+    if (priv->size == 0)
+    {
+        return NULL;
+    }
+
+    return priv->data;
+}
+
 /**
  * cattle_buffer_set_value:
  * @buffer: a #CattleBuffer
@@ -200,7 +447,8 @@ cattle_buffer_set_contents_full (CattleBuffer *self,
  * Set the value of a specific byte inside the memory buffer.
  *
  * The value of @position must be smaller than the size of the
- * memory buffer, as returned by cattle_buffer_get_size().
+ * memory buffer, as returned by cattle_buffer_get_size(), and @buffer
+ * must not be read-only.
  */
 void
 cattle_buffer_set_value (CattleBuffer *self,
@@ -213,6 +461,7 @@ cattle_buffer_set_value (CattleBuffer *self,
 
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
+    g_return_if_fail (!priv->read_only);
     g_return_if_fail (position < priv->size);
 
     priv->data[position] = value;
@@ -51,18 +51,30 @@ struct _CattleBufferClass
     GObjectClass parent;
 };
 
-CattleBuffer* cattle_buffer_new               (gulong        size);
-void          cattle_buffer_set_contents      (CattleBuffer *buffer,
-                                               gint8        *contents);
-void          cattle_buffer_set_contents_full (CattleBuffer *buffer,
-                                               gint8        *contents,
-                                               gulong        size);
-void          cattle_buffer_set_value         (CattleBuffer *buffer,
-                                               gulong        position,
-                                               gint8         value);
-gint8         cattle_buffer_get_value         (CattleBuffer *buffer,
-                                               gulong        position);
-gulong        cattle_buffer_get_size          (CattleBuffer *buffer);
+CattleBuffer* cattle_buffer_new               (gulong         size);
+CattleBuffer* cattle_buffer_new_from_bytes    (GBytes        *bytes);
+CattleBuffer* cattle_buffer_new_from_file     (const gchar   *path,
+                                               GError       **error);
+CattleBuffer* cattle_buffer_new_slice         (CattleBuffer  *buffer,
+                                               gulong         offset,
+                                               gulong         size);
+void          cattle_buffer_set_contents      (CattleBuffer  *buffer,
+                                               gint8         *contents);
+void          cattle_buffer_set_contents_full (CattleBuffer  *buffer,
+                                               gint8         *contents,
+                                               gulong         size);
+void          cattle_buffer_get_contents      (CattleBuffer  *buffer,
+                                               gint8         *contents);
+void          cattle_buffer_get_contents_full (CattleBuffer  *buffer,
+                                               gint8         *contents,
+                                               gulong         size);
+const gint8*  cattle_buffer_peek_contents     (CattleBuffer  *buffer);
+void          cattle_buffer_set_value         (CattleBuffer  *buffer,
+                                               gulong         position,
+                                               gint8          value);
+gint8         cattle_buffer_get_value         (CattleBuffer  *buffer,
+                                               gulong         position);
+gulong        cattle_buffer_get_size          (CattleBuffer  *buffer);
 
 GType         cattle_buffer_get_type          (void) G_GNUC_CONST;
 
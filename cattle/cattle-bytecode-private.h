@@ -0,0 +1,95 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#if !defined (CATTLE_COMPILATION)
+#error "This header is private to Cattle and can't be included directly."
+#endif
+
+#ifndef __CATTLE_BYTECODE_PRIVATE_H__
+#define __CATTLE_BYTECODE_PRIVATE_H__
+
+#include <glib.h>
+#include "cattle-node-private.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    CATTLE_OP_END,        /* Stop execution */
+    CATTLE_OP_MOVE_LEFT,  /* Move the tape quantity cells to the left */
+    CATTLE_OP_MOVE_RIGHT, /* Move the tape quantity cells to the right */
+    CATTLE_OP_INCREASE,   /* Increase the value offset cells away by
+                           * quantity, modulo the cell width */
+    CATTLE_OP_LOOP_BEGIN, /* Jump past the op at jump, usually the
+                           * matching CATTLE_OP_LOOP_END, if the current
+                           * value is zero */
+    CATTLE_OP_LOOP_END,   /* Jump back past the matching
+                           * CATTLE_OP_LOOP_BEGIN if the current value
+                           * is not zero */
+    CATTLE_OP_READ,       /* Read quantity values from the input */
+    CATTLE_OP_PRINT,      /* Print the current value quantity times */
+    CATTLE_OP_DEBUG,      /* Call the debug handler quantity times */
+    CATTLE_OP_SET_ZERO,   /* Set the current value to zero */
+    CATTLE_OP_MULTIPLY,   /* Add the current value times quantity to
+                           * the value offset cells away */
+    CATTLE_OP_SCAN_LEFT,  /* Move the tape quantity cells to the left
+                           * until the current value is zero */
+    CATTLE_OP_SCAN_RIGHT, /* Move the tape quantity cells to the right
+                           * until the current value is zero */
+    CATTLE_OP_UNBALANCED  /* Stop execution with an error */
+} CattleOpcode;
+
+typedef struct _CattleOp       CattleOp;
+typedef struct _CattleBytecode CattleBytecode;
+typedef struct _CattleJitCode  CattleJitCode;
+
+struct _CattleOp
+{
+    CattleOpcode opcode;
+    gulong       quantity;
+    gulong       jump;     /* Index of the matching loop op */
+    glong        offset;   /* Position of the target cell, relative
+                            * to the current one */
+};
+
+struct _CattleBytecode
+{
+    gint           ref_count;
+
+    CattleOp      *ops;
+    gulong         n_ops;
+
+    CattleJitCode *native;                  /* Native code, if available */
+    gboolean       native_compiled;         /* Whether native code
+                                             * generation has already
+                                             * been attempted */
+    CattleJitCode *native_trusted;          /* Native code without any
+                                             * bounds checks */
+    gboolean       native_trusted_compiled;
+};
+
+CattleBytecode* cattle_bytecode_compile    (GArray            *nodes);
+CattleBytecode* cattle_bytecode_ref        (CattleBytecode    *bytecode);
+void            cattle_bytecode_unref      (CattleBytecode    *bytecode);
+CattleJitCode*  cattle_bytecode_get_native (CattleBytecode    *bytecode,
+                                            gboolean           trusted);
+
+G_END_DECLS
+
+#endif /* __CATTLE_BYTECODE_PRIVATE_H__ */
@@ -0,0 +1,650 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#include "cattle-bytecode-private.h"
+#include "cattle-jit-private.h"
+
+/* The bytecode is a flat array of operations compiled from the nodes
+ * making up a program. It's what the interpreter actually executes.
+ *
+ * Loops are compiled to a pair of operations pointing at each other,
+ * so that entering, repeating and leaving a loop are just jumps.
+ * Some common kinds of loops are recognized and compiled to simpler
+ * operations that have the same effect instead.
+ *
+ * Programs with unbalanced brackets, which can only be built by hand,
+ * are compiled so that they fail at the same point the object graph
+ * would: when a %CATTLE_INSTRUCTION_LOOP_END is reached outside of a
+ * loop, or when the instructions inside a loop run out before a
+ * %CATTLE_INSTRUCTION_LOOP_END is found. */
+
+static gulong
+emit (GArray       *ops,
+      CattleOpcode  opcode,
+      gulong        quantity)
+{
+    CattleOp op;
+
+    op.opcode = opcode;
+    op.quantity = quantity;
+    op.jump = 0;
+    op.offset = 0;
+
+    g_array_append_val (ops, op);
+
+    return ops->len - 1;
+}
+
+/* Close the loop starting at @begin by emitting an op of type @opcode
+ * and linking the two together */
+static void
+close_loop (GArray       *ops,
+            gulong        begin,
+            CattleOpcode  opcode)
+{
+    gulong end;
+
+    end = emit (ops, opcode, 1);
+
+    g_array_index (ops, CattleOp, end).jump = begin;
+    g_array_index (ops, CattleOp, begin).jump = end;
+}
+
+/* Check whether the loop starting at @begin is a clear loop, that is,
+ * one that only changes the current value by an odd amount, such as
+ * [-] or [+]. Since the current value goes through all possible values
+ * before reaching zero again, such a loop always terminates and its
+ * only effect is to set the current value to zero */
+static gboolean
+is_clear_loop (CattleNode *nodes,
+               gulong      begin)
+{
+    CattleNode *body;
+
+    body = &nodes[begin + 1];
+
+    return nodes[begin].jump == begin + 2 &&
+           nodes[begin + 2].value == CATTLE_INSTRUCTION_LOOP_END &&
+           (body->value == CATTLE_INSTRUCTION_INCREASE ||
+            body->value == CATTLE_INSTRUCTION_DECREASE) &&
+           body->quantity % 2 == 1;
+}
+
+/* Check whether the loop starting at @begin is a scan loop, that is,
+ * one that only moves the tape in a single direction, such as [>] or
+ * [<<<]. Such a loop stops at the first cell containing zero it finds,
+ * so it can be replaced by a search over the tape.
+ *
+ * If it is, @opcode and @stride are set to the op that performs the
+ * search and the distance between the cells it checks */
+static gboolean
+is_scan_loop (CattleNode   *nodes,
+              gulong        begin,
+              CattleOpcode *opcode,
+              gulong       *stride)
+{
+    CattleNode *body;
+
+    body = &nodes[begin + 1];
+
+    if (nodes[begin].jump != begin + 2 ||
+        nodes[begin + 2].value != CATTLE_INSTRUCTION_LOOP_END ||
+        (body->value != CATTLE_INSTRUCTION_MOVE_LEFT &&
+         body->value != CATTLE_INSTRUCTION_MOVE_RIGHT))
+    {
+        return FALSE;
+    }
+
+    *opcode = (body->value == CATTLE_INSTRUCTION_MOVE_LEFT) ? CATTLE_OP_SCAN_LEFT
+                                                            : CATTLE_OP_SCAN_RIGHT;
+    *stride = body->quantity;
+
+    return TRUE;
+}
+
+typedef struct _CattleBytecodeTarget CattleBytecodeTarget;
+
+struct _CattleBytecodeTarget
+{
+    glong   offset; /* Position relative to the starting cell */
+    guint32 delta;  /* Change to the value stored there, modulo 2^32
+                     * so that it's correct for all cell widths */
+};
+
+/* Get the target at @offset, creating it if needed */
+static CattleBytecodeTarget*
+get_target (GArray *targets,
+            glong   offset)
+{
+    CattleBytecodeTarget  target;
+    guint                 i;
+
+    for (i = 0; i < targets->len; i++)
+    {
+        if (g_array_index (targets, CattleBytecodeTarget, i).offset == offset)
+        {
+            return &g_array_index (targets, CattleBytecodeTarget, i);
+        }
+    }
+
+    target.offset = offset;
+    target.delta = 0;
+    g_array_append_val (targets, target);
+
+    return &g_array_index (targets, CattleBytecodeTarget, targets->len - 1);
+}
+
+/* Collect the effect of the moves and updates starting at @start into
+ * @targets, stopping at the first node of any other kind, before a
+ * move that could make the offsets overflow, or once @max_targets
+ * cells have been updated.
+ *
+ * @position is set to the position the tape ends up in, and @lowest
+ * and @highest to the positions furthest from the start it reaches.
+ *
+ * Returns: the index of the first node that has not been collected */
+static gulong
+collect_updates (CattleNode *nodes,
+                 gulong      n_nodes,
+                 gulong      start,
+                 GArray     *targets,
+                 guint       max_targets,
+                 glong      *position,
+                 glong      *lowest,
+                 glong      *highest)
+{
+    CattleBytecodeTarget *target;
+    CattleNode           *node;
+    gulong                i;
+
+    *position = 0;
+    *lowest = 0;
+    *highest = 0;
+
+    for (i = start; i < n_nodes && targets->len < max_targets; i++)
+    {
+        node = &nodes[i];
+
+        if ((node->value == CATTLE_INSTRUCTION_MOVE_LEFT ||
+             node->value == CATTLE_INSTRUCTION_MOVE_RIGHT) &&
+            node->quantity > (gulong) (G_MAXINT32 - ABS (*position)))
+        {
+            break;
+        }
+
+        if (node->value == CATTLE_INSTRUCTION_MOVE_LEFT)
+        {
+            *position -= node->quantity;
+            *lowest = MIN (*lowest, *position);
+        }
+        else if (node->value == CATTLE_INSTRUCTION_MOVE_RIGHT)
+        {
+            *position += node->quantity;
+            *highest = MAX (*highest, *position);
+        }
+        else if (node->value == CATTLE_INSTRUCTION_INCREASE)
+        {
+            target = get_target (targets, *position);
+            target->delta += node->quantity;
+        }
+        else if (node->value == CATTLE_INSTRUCTION_DECREASE)
+        {
+            target = get_target (targets, *position);
+            target->delta -= node->quantity;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/* Maximum number of cells a single block can update. Looking up
+ * targets takes linear time, so very long blocks are split */
+#define BLOCK_MAX_TARGETS 64
+
+/* Compile the straight-line block of moves and updates starting at
+ * @start, such as >+>>--<<<.
+ *
+ * Updates are compiled to ops that address cells relative to the
+ * position the block started from, and the tape is moved only once,
+ * at the end of the block. Updates to the same cell are merged.
+ *
+ * Returns: the index of the first node that is not part of the block */
+static gulong
+compile_block (GArray     *ops,
+               CattleNode *nodes,
+               gulong      n_nodes,
+               gulong      start)
+{
+    CattleBytecodeTarget *target;
+    GArray               *targets;
+    gulong                index;
+    gulong                end;
+    glong                 position;
+    glong                 lowest;
+    glong                 highest;
+    guint                 i;
+
+    targets = g_array_new (FALSE, FALSE, sizeof (CattleBytecodeTarget));
+
+    end = collect_updates (nodes,
+                           n_nodes,
+                           start,
+                           targets,
+                           BLOCK_MAX_TARGETS,
+                           &position,
+                           &lowest,
+                           &highest);
+
+    /* The block touches all cells between the lowest and the highest
+     * position it reaches, so the tape has to grow to include them
+     * even when no value is changed there */
+    get_target (targets, lowest);
+    get_target (targets, highest);
+
+    for (i = 0; i < targets->len; i++)
+    {
+        target = &g_array_index (targets, CattleBytecodeTarget, i);
+
+        /* Cells whose value doesn't change only need to be updated if
+         * the tape wouldn't reach them otherwise */
+        if (target->delta == 0 &&
+            (target->offset == 0 || target->offset == position))
+        {
+            continue;
+        }
+
+        index = emit (ops, CATTLE_OP_INCREASE, target->delta);
+        g_array_index (ops, CattleOp, index).offset = target->offset;
+    }
+
+    if (position < 0)
+    {
+        emit (ops, CATTLE_OP_MOVE_LEFT, -position);
+    }
+    else if (position > 0)
+    {
+        emit (ops, CATTLE_OP_MOVE_RIGHT, position);
+    }
+
+    g_array_free (targets, TRUE);
+
+    return end;
+}
+
+/* Try to compile the loop starting at @begin as a multiply loop, such
+ * as [->+>+++<<]: the body contains no nested loops or I/O, the tape
+ * ends up in the same position it started from, and the value in that
+ * position, the loop counter, changes by an odd amount.
+ *
+ * The number of iterations can then be computed from the loop counter
+ * alone, and the effect of the loop on every other cell is to add a
+ * multiple of the loop counter to it. Just like for clear loops, the
+ * counter ends up being zero.
+ *
+ * Returns: %TRUE if the loop has been compiled, %FALSE otherwise */
+static gboolean
+compile_multiply_loop (GArray     *ops,
+                       CattleNode *nodes,
+                       gulong      begin)
+{
+    CattleBytecodeTarget *target;
+    GArray               *targets;
+    gulong                loop_begin;
+    gulong                end;
+    gulong                index;
+    glong                 position;
+    glong                 lowest;
+    glong                 highest;
+    guint32               inverse;
+    guint32               counter;
+    guint                 i;
+
+    end = nodes[begin].jump;
+
+    if (nodes[end].value != CATTLE_INSTRUCTION_LOOP_END)
+    {
+        return FALSE;
+    }
+
+    targets = g_array_new (FALSE, FALSE, sizeof (CattleBytecodeTarget));
+
+    /* The loop counter always comes first */
+    get_target (targets, 0);
+
+    /* The whole body has to be made of moves and updates */
+    if (collect_updates (nodes,
+                         end,
+                         begin + 1,
+                         targets,
+                         G_MAXUINT,
+                         &position,
+                         &lowest,
+                         &highest) != end)
+    {
+        g_array_free (targets, TRUE);
+
+        return FALSE;
+    }
+
+    counter = g_array_index (targets, CattleBytecodeTarget, 0).delta;
+
+    if (position != 0 || counter % 2 == 0)
+    {
+        g_array_free (targets, TRUE);
+
+        return FALSE;
+    }
+
+    /* The loop touches all cells between the lowest and the highest
+     * position it reaches, so the tape has to grow to include them
+     * even when no value is changed there */
+    get_target (targets, lowest);
+    get_target (targets, highest);
+
+    /* The loop runs until counter * iterations + value is zero,
+     * modulo 2^width, so each iteration is worth -1/counter times the
+     * value. Since counter is odd, its inverse exists and can be
+     * found using Newton's method, which doubles the number of
+     * correct bits at each step. The inverse modulo 2^32 works for
+     * all cell widths */
+    inverse = counter;
+    inverse *= 2 - counter * inverse;
+    inverse *= 2 - counter * inverse;
+    inverse *= 2 - counter * inverse;
+    inverse *= 2 - counter * inverse;
+
+    /* Skip everything if the loop counter is zero */
+    loop_begin = emit (ops, CATTLE_OP_LOOP_BEGIN, 1);
+
+    for (i = 1; i < targets->len; i++)
+    {
+        target = &g_array_index (targets, CattleBytecodeTarget, i);
+
+        index = emit (ops,
+                      CATTLE_OP_MULTIPLY,
+                      (guint32) (target->delta * -inverse));
+        g_array_index (ops, CattleOp, index).offset = target->offset;
+    }
+
+    index = emit (ops, CATTLE_OP_SET_ZERO, 1);
+    g_array_index (ops, CattleOp, loop_begin).jump = index;
+
+    g_array_free (targets, TRUE);
+
+    return TRUE;
+}
+
+/* Compile @nodes to bytecode. Loops are tracked using an explicit
+ * stack, so the nesting level is only limited by the amount of
+ * available memory */
+CattleBytecode*
+cattle_bytecode_compile (GArray *nodes)
+{
+    CattleBytecode *bytecode;
+    CattleNode     *node;
+    CattleOpcode    opcode;
+    GArray         *ops;
+    GArray         *stack;
+    gulong          begin;
+    gulong          stride;
+    gulong          n_nodes;
+    gulong          i;
+
+    g_return_val_if_fail (nodes != NULL, NULL);
+
+    ops = g_array_new (FALSE, FALSE, sizeof (CattleOp));
+    stack = g_array_new (FALSE, FALSE, sizeof (gulong));
+
+    n_nodes = nodes->len;
+    i = 0;
+
+    while (i < n_nodes)
+    {
+        node = &g_array_index (nodes, CattleNode, i);
+
+        switch (node->value)
+        {
+            case CATTLE_INSTRUCTION_LOOP_BEGIN:
+
+                /* Loops that can be compiled to simpler ops are
+                 * skipped entirely */
+                if (is_clear_loop ((CattleNode *) nodes->data, i))
+                {
+                    emit (ops, CATTLE_OP_SET_ZERO, 1);
+                    i = node->jump + 1;
+
+                    break;
+                }
+
+                if (is_scan_loop ((CattleNode *) nodes->data, i, &opcode, &stride))
+                {
+                    emit (ops, opcode, stride);
+                    i = node->jump + 1;
+
+                    break;
+                }
+
+                if (compile_multiply_loop (ops, (CattleNode *) nodes->data, i))
+                {
+                    i = node->jump + 1;
+
+                    break;
+                }
+
+                begin = emit (ops, CATTLE_OP_LOOP_BEGIN, 1);
+                g_array_append_val (stack, begin);
+                i++;
+
+                break;
+
+            case CATTLE_INSTRUCTION_LOOP_END:
+            case CATTLE_NODE_UNBALANCED:
+
+                if (stack->len == 0)
+                {
+                    /* Not inside a loop: reaching this point is an
+                     * error, and nothing past it can be executed */
+                    emit (ops, CATTLE_OP_UNBALANCED, 1);
+                    i = n_nodes;
+
+                    break;
+                }
+
+                begin = g_array_index (stack, gulong, stack->len - 1);
+                g_array_set_size (stack, stack->len - 1);
+
+                /* A loop whose instructions ran out before it was
+                 * closed fails as soon as it's entered */
+                close_loop (ops,
+                            begin,
+                            node->value == CATTLE_INSTRUCTION_LOOP_END ? CATTLE_OP_LOOP_END
+                                                                       : CATTLE_OP_UNBALANCED);
+                i++;
+
+                break;
+
+            case CATTLE_INSTRUCTION_MOVE_LEFT:
+            case CATTLE_INSTRUCTION_MOVE_RIGHT:
+
+                /* Moves that are too long to be part of a block are
+                 * compiled on their own */
+                if (node->quantity > G_MAXINT32)
+                {
+                    emit (ops,
+                          node->value == CATTLE_INSTRUCTION_MOVE_LEFT ? CATTLE_OP_MOVE_LEFT
+                                                                      : CATTLE_OP_MOVE_RIGHT,
+                          node->quantity);
+                    i++;
+
+                    break;
+                }
+
+                i = compile_block (ops, (CattleNode *) nodes->data, n_nodes, i);
+
+                break;
+
+            case CATTLE_INSTRUCTION_INCREASE:
+            case CATTLE_INSTRUCTION_DECREASE:
+
+                i = compile_block (ops, (CattleNode *) nodes->data, n_nodes, i);
+
+                break;
+
+            case CATTLE_INSTRUCTION_READ:
+
+                emit (ops, CATTLE_OP_READ, node->quantity);
+                i++;
+
+                break;
+
+            case CATTLE_INSTRUCTION_PRINT:
+
+                emit (ops, CATTLE_OP_PRINT, node->quantity);
+                i++;
+
+                break;
+
+            case CATTLE_INSTRUCTION_DEBUG:
+
+                emit (ops, CATTLE_OP_DEBUG, node->quantity);
+                i++;
+
+                break;
+
+            default:
+
+                /* Nothing to execute */
+                i++;
+
+                break;
+        }
+    }
+
+    emit (ops, CATTLE_OP_END, 1);
+
+    g_array_free (stack, TRUE);
+
+    bytecode = g_new0 (CattleBytecode, 1);
+    bytecode->ref_count = 1;
+    bytecode->n_ops = ops->len;
+    bytecode->ops = (CattleOp *) (gpointer) g_array_free (ops, FALSE);
+    bytecode->native = NULL;
+    bytecode->native_compiled = FALSE;
+    bytecode->native_trusted = NULL;
+    bytecode->native_trusted_compiled = FALSE;
+
+    return bytecode;
+}
+
+CattleBytecode*
+cattle_bytecode_ref (CattleBytecode *bytecode)
+{
+    g_return_val_if_fail (bytecode != NULL, NULL);
+
+    g_atomic_int_inc (&bytecode->ref_count);
+
+    return bytecode;
+}
+
+void
+cattle_bytecode_unref (CattleBytecode *bytecode)
+{
+    g_return_if_fail (bytecode != NULL);
+
+    /* The same bytecode can be run by interpreters living in
+     * different threads */
+    if (!g_atomic_int_dec_and_test (&bytecode->ref_count))
+    {
+        return;
+    }
+
+    if (bytecode->native != NULL)
+    {
+        cattle_jit_free (bytecode->native);
+    }
+    if (bytecode->native_trusted != NULL)
+    {
+        cattle_jit_free (bytecode->native_trusted);
+    }
+
+    g_free (bytecode->ops);
+    g_free (bytecode);
+}
+
+/* Get the native code stored in @slot, generating it if that hasn't
+ * been attempted already. The same bytecode can be run from several
+ * threads, so the code is published atomically: a thread that loses
+ * the race throws its own copy away */
+static CattleJitCode*
+get_native (CattleBytecode  *bytecode,
+            CattleJitCode  **slot,
+            gboolean        *compiled,
+            gboolean         trusted)
+{
+    CattleJitCode *native;
+
+    native = g_atomic_pointer_get (slot);
+
+    if (native != NULL || g_atomic_int_get (compiled))
+    {
+        return native;
+    }
+
+    native = cattle_jit_compile (bytecode, trusted);
+
+    if (native != NULL &&
+        !g_atomic_pointer_compare_and_exchange (slot, NULL, native))
+    {
+        cattle_jit_free (native);
+        native = g_atomic_pointer_get (slot);
+    }
+
+    /* Failures are not stored, but they're the same for every thread,
+     * so there's no need to try again */
+    g_atomic_int_set (compiled, TRUE);
+
+    return native;
+}
+
+/* Get native code for @bytecode, generating it if that hasn't been
+ * attempted already. See cattle_jit_compile() for the meaning of
+ * @trusted. Returns NULL if native code is not available */
+CattleJitCode*
+cattle_bytecode_get_native (CattleBytecode *bytecode,
+                            gboolean        trusted)
+{
+    g_return_val_if_fail (bytecode != NULL, NULL);
+
+    if (trusted)
+    {
+        return get_native (bytecode,
+                           &bytecode->native_trusted,
+                           &bytecode->native_trusted_compiled,
+                           TRUE);
+    }
+
+    return get_native (bytecode,
+                       &bytecode->native,
+                       &bytecode->native_compiled,
+                       FALSE);
+}
@@ -39,6 +39,32 @@
  * of input is reached.
  */
 
+/**
+ * CattleEngine:
+ * @CATTLE_ENGINE_SWITCH: Dispatch instructions using a switch
+ * statement. It works with any compiler, but is slower
+ * @CATTLE_ENGINE_THREADED: Jump from the code for an instruction
+ * directly to the code for the next one. This is the default
+ * behaviour. If Cattle has been built with a compiler that doesn't
+ * support this, %CATTLE_ENGINE_SWITCH is used instead
+ * @CATTLE_ENGINE_JIT: Translate the program to native code before
+ * running it. This is usually much faster, but is only available on
+ * some architectures: everywhere else, %CATTLE_ENGINE_THREADED is
+ * used instead
+ *
+ * Possible engines used by a #CattleInterpreter to execute a program.
+ */
+
+/**
+ * CattleCellWidth:
+ * @CATTLE_CELL_WIDTH_8: Each cell holds 8 bits. This is the default
+ * behaviour
+ * @CATTLE_CELL_WIDTH_16: Each cell holds 16 bits
+ * @CATTLE_CELL_WIDTH_32: Each cell holds 32 bits
+ *
+ * Possible sizes of the cells in the tape used by a #CattleInterpreter.
+ */
+
 /**
  * CattleConfiguration:
  *
@@ -52,6 +78,11 @@ struct _CattleConfigurationPrivate
 
     CattleEndOfInputAction end_of_input_action;
     gboolean               debug_is_enabled;
+    CattleEngine           engine;
+    gulong                 tape_size;
+    gboolean               bounds_check_is_enabled;
+    CattleCellWidth        cell_width;
+    gulong                 input_buffer_size;
 };
 
 G_DEFINE_TYPE_WITH_CODE (CattleConfiguration, cattle_configuration, G_TYPE_OBJECT,
@@ -62,7 +93,12 @@ enum
 {
     PROP_0,
     PROP_END_OF_INPUT_ACTION,
-    PROP_DEBUG_IS_ENABLED
+    PROP_DEBUG_IS_ENABLED,
+    PROP_ENGINE,
+    PROP_TAPE_SIZE,
+    PROP_BOUNDS_CHECK_IS_ENABLED,
+    PROP_CELL_WIDTH,
+    PROP_INPUT_BUFFER_SIZE
 };
 
 static void
@@ -74,6 +110,11 @@ cattle_configuration_init (CattleConfiguration *self)
 
     priv->end_of_input_action = CATTLE_END_OF_INPUT_ACTION_STORE_ZERO;
     priv->debug_is_enabled = FALSE;
+    priv->engine = CATTLE_ENGINE_THREADED;
+    priv->tape_size = 0;
+    priv->bounds_check_is_enabled = TRUE;
+    priv->cell_width = CATTLE_CELL_WIDTH_8;
+    priv->input_buffer_size = 4096;
 
     priv->disposed = FALSE;
 
@@ -219,6 +260,288 @@ cattle_configuration_get_debug_is_enabled (CattleConfiguration *self)
     return priv->debug_is_enabled;
 }
 
+/**
+ * cattle_configuration_set_engine:
+ * @configuration: a #CattleConfiguration
+ * @engine: the engine to be used
+ *
+ * Set the engine used to execute programs.
+ *
+ * All engines behave exactly the same way, and differ only in
+ * performance.
+ *
+ * Accepted values are from the #CattleEngine enumeration.
+ */
+void
+cattle_configuration_set_engine (CattleConfiguration *self,
+                                 CattleEngine         engine)
+{
+    CattleConfigurationPrivate *priv;
+    gpointer                    enum_class;
+    GEnumValue                 *enum_value;
+
+    g_return_if_fail (CATTLE_IS_CONFIGURATION (self));
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    /* Get the enum class for engines, and lookup the value.
+     * If it is not present, the engine is not valid */
+    enum_class = g_type_class_ref (CATTLE_TYPE_ENGINE);
+    enum_value = g_enum_get_value (enum_class, engine);
+    g_type_class_unref (enum_class);
+    g_return_if_fail (enum_value != NULL);
+
+    priv->engine = engine;
+}
+
+/**
+ * cattle_configuration_get_engine:
+ * @configuration: a #CattleConfiguration
+ *
+ * Get the engine used to execute programs.
+ * See cattle_configuration_set_engine().
+ *
+ * Returns: the current engine
+ */
+CattleEngine
+cattle_configuration_get_engine (CattleConfiguration *self)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_CONFIGURATION (self), CATTLE_ENGINE_THREADED);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, CATTLE_ENGINE_THREADED);
+
+    return priv->engine;
+}
+
+/**
+ * cattle_configuration_set_tape_size:
+ * @configuration: a #CattleConfiguration
+ * @size: number of cells, or zero
+ *
+ * Set the size of the tape used to run programs. The default is zero,
+ * which means the tape grows as more cells are needed.
+ *
+ * If @size is not zero, the tape is allocated in full before the
+ * program is run and never grows, which makes moving around faster.
+ * Programs are not allowed to move past either end of the tape: see
+ * cattle_configuration_set_bounds_check_is_enabled().
+ *
+ * The classic size for a Brainfuck tape is 30000 cells.
+ */
+void
+cattle_configuration_set_tape_size (CattleConfiguration *self,
+                                    gulong               size)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_CONFIGURATION (self));
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    priv->tape_size = size;
+}
+
+/**
+ * cattle_configuration_get_tape_size:
+ * @configuration: a #CattleConfiguration
+ *
+ * Get the size of the tape used to run programs.
+ * See cattle_configuration_set_tape_size().
+ *
+ * Returns: the number of cells in the tape, or zero if the tape grows
+ * as needed
+ */
+gulong
+cattle_configuration_get_tape_size (CattleConfiguration *self)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_CONFIGURATION (self), 0);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, 0);
+
+    return priv->tape_size;
+}
+
+/**
+ * cattle_configuration_set_bounds_check_is_enabled:
+ * @configuration: a #CattleConfiguration
+ * @enabled: %TRUE to enable bounds checking, %FALSE otherwise
+ *
+ * Set the status of bounds checking for fixed-size tapes. It is
+ * enabled by default, and has no effect unless a tape size has been
+ * set using cattle_configuration_set_tape_size().
+ *
+ * If bounds checking is enabled, a program trying to move past either
+ * end of the tape is stopped with a %CATTLE_ERROR_TAPE_OUT_OF_BOUNDS
+ * error, even if it moves back right away.
+ *
+ * If it is disabled, most moves are not checked at all, which makes
+ * them slightly faster: this should only be done for trusted
+ * programs, because the behaviour of a program moving past either
+ * end of the tape is undefined. The tape is surrounded by inaccessible
+ * memory, so such a program usually crashes as soon as it touches a
+ * cell past either end, regardless of the engine. Moves long enough to
+ * jump over that memory are still checked, and so are all moves on
+ * systems where it can't be set up.
+ */
+void
+cattle_configuration_set_bounds_check_is_enabled (CattleConfiguration *self,
+                                                  gboolean             enabled)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_CONFIGURATION (self));
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    priv->bounds_check_is_enabled = enabled;
+}
+
+/**
+ * cattle_configuration_get_bounds_check_is_enabled:
+ * @configuration: a #CattleConfiguration
+ *
+ * Get the current status of bounds checking.
+ * See cattle_configuration_set_bounds_check_is_enabled().
+ *
+ * Returns: %TRUE if bounds checking is enabled, %FALSE otherwise
+ */
+gboolean
+cattle_configuration_get_bounds_check_is_enabled (CattleConfiguration *self)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_CONFIGURATION (self), TRUE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, TRUE);
+
+    return priv->bounds_check_is_enabled;
+}
+
+/**
+ * cattle_configuration_set_cell_width:
+ * @configuration: a #CattleConfiguration
+ * @width: the width of each cell
+ *
+ * Set the width of the cells in the tape used to run programs. The
+ * default is %CATTLE_CELL_WIDTH_8.
+ *
+ * Values in wider cells wrap around at a larger value, but input and
+ * output still happen one byte at a time: only the lowest 8 bits of
+ * a cell are printed, and values read from the input are always
+ * between 0 and 255, except for the end of input marker stored when
+ * using %CATTLE_END_OF_INPUT_ACTION_STORE_EOF.
+ *
+ * Native code is only generated for 8 bit cells: for other widths,
+ * %CATTLE_ENGINE_JIT behaves like %CATTLE_ENGINE_THREADED.
+ *
+ * Accepted values are from the #CattleCellWidth enumeration.
+ */
+void
+cattle_configuration_set_cell_width (CattleConfiguration *self,
+                                     CattleCellWidth      width)
+{
+    CattleConfigurationPrivate *priv;
+    gpointer                    enum_class;
+    GEnumValue                 *enum_value;
+
+    g_return_if_fail (CATTLE_IS_CONFIGURATION (self));
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    /* Get the enum class for cell widths, and lookup the value.
+     * If it is not present, the width is not valid */
+    enum_class = g_type_class_ref (CATTLE_TYPE_CELL_WIDTH);
+    enum_value = g_enum_get_value (enum_class, width);
+    g_type_class_unref (enum_class);
+    g_return_if_fail (enum_value != NULL);
+
+    priv->cell_width = width;
+}
+
+/**
+ * cattle_configuration_get_cell_width:
+ * @configuration: a #CattleConfiguration
+ *
+ * Get the width of the cells in the tape used to run programs.
+ * See cattle_configuration_set_cell_width().
+ *
+ * Returns: the current cell width
+ */
+CattleCellWidth
+cattle_configuration_get_cell_width (CattleConfiguration *self)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_CONFIGURATION (self), CATTLE_CELL_WIDTH_8);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, CATTLE_CELL_WIDTH_8);
+
+    return priv->cell_width;
+}
+
+/**
+ * cattle_configuration_set_input_buffer_size:
+ * @configuration: a #CattleConfiguration
+ * @size: number of values, greater than zero
+ *
+ * Set the size of the buffer that bulk input handlers read input
+ * into. The default is 4096 values.
+ *
+ * The buffer is allocated once and reused for all input, so a larger
+ * buffer means fewer invocations of the handler when a program reads
+ * a lot of input.
+ * See cattle_interpreter_set_bulk_input_handler().
+ */
+void
+cattle_configuration_set_input_buffer_size (CattleConfiguration *self,
+                                            gulong               size)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_CONFIGURATION (self));
+    g_return_if_fail (size > 0);
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    priv->input_buffer_size = size;
+}
+
+/**
+ * cattle_configuration_get_input_buffer_size:
+ * @configuration: a #CattleConfiguration
+ *
+ * Get the size of the buffer that bulk input handlers read input
+ * into.
+ * See cattle_configuration_set_input_buffer_size().
+ *
+ * Returns: the number of values in the input buffer
+ */
+gulong
+cattle_configuration_get_input_buffer_size (CattleConfiguration *self)
+{
+    CattleConfigurationPrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_CONFIGURATION (self), 4096);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, 4096);
+
+    return priv->input_buffer_size;
+}
+
 static void
 cattle_configuration_set_property (GObject      *object,
                                    guint         property_id,
@@ -228,6 +551,7 @@ cattle_configuration_set_property (GObject      *object,
     CattleConfiguration *self;
     gint                 v_enum;
     gboolean             v_bool;
+    gulong               v_ulong;
 
     self = CATTLE_CONFIGURATION (object);
 
@@ -249,6 +573,46 @@ cattle_configuration_set_property (GObject      *object,
 
             break;
 
+        case PROP_ENGINE:
+
+            v_enum = g_value_get_enum (value);
+            cattle_configuration_set_engine (self,
+                                             v_enum);
+
+            break;
+
+        case PROP_TAPE_SIZE:
+
+            v_ulong = g_value_get_ulong (value);
+            cattle_configuration_set_tape_size (self,
+                                                v_ulong);
+
+            break;
+
+        case PROP_BOUNDS_CHECK_IS_ENABLED:
+
+            v_bool = g_value_get_boolean (value);
+            cattle_configuration_set_bounds_check_is_enabled (self,
+                                                              v_bool);
+
+            break;
+
+        case PROP_CELL_WIDTH:
+
+            v_enum = g_value_get_enum (value);
+            cattle_configuration_set_cell_width (self,
+                                                 v_enum);
+
+            break;
+
+        case PROP_INPUT_BUFFER_SIZE:
+
+            v_ulong = g_value_get_ulong (value);
+            cattle_configuration_set_input_buffer_size (self,
+                                                        v_ulong);
+
+            break;
+
         default:
 
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
@@ -268,6 +632,7 @@ cattle_configuration_get_property (GObject    *object,
     CattleConfiguration *self;
     gint                 v_enum;
     gboolean             v_bool;
+    gulong               v_ulong;
 
     self = CATTLE_CONFIGURATION (object);
 
@@ -287,6 +652,41 @@ cattle_configuration_get_property (GObject    *object,
 
             break;
 
+        case PROP_ENGINE:
+
+            v_enum = cattle_configuration_get_engine (self);
+            g_value_set_enum (value, v_enum);
+
+            break;
+
+        case PROP_TAPE_SIZE:
+
+            v_ulong = cattle_configuration_get_tape_size (self);
+            g_value_set_ulong (value, v_ulong);
+
+            break;
+
+        case PROP_BOUNDS_CHECK_IS_ENABLED:
+
+            v_bool = cattle_configuration_get_bounds_check_is_enabled (self);
+            g_value_set_boolean (value, v_bool);
+
+            break;
+
+        case PROP_CELL_WIDTH:
+
+            v_enum = cattle_configuration_get_cell_width (self);
+            g_value_set_enum (value, v_enum);
+
+            break;
+
+        case PROP_INPUT_BUFFER_SIZE:
+
+            v_ulong = cattle_configuration_get_input_buffer_size (self);
+            g_value_set_ulong (value, v_ulong);
+
+            break;
+
         default:
 
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
@@ -343,4 +743,93 @@ cattle_configuration_class_init (CattleConfigurationClass *self)
     g_object_class_install_property (object_class,
                                      PROP_DEBUG_IS_ENABLED,
                                      pspec);
+
+    /**
+     * CattleConfiguration:engine:
+     *
+     * Engine used to execute programs.
+     *
+     * Changes to this property are not notified.
+     */
+    pspec = g_param_spec_enum ("engine",
+                               "Engine used to execute programs",
+                               "Get/set engine",
+                               CATTLE_TYPE_ENGINE,
+                               CATTLE_ENGINE_THREADED,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property (object_class,
+                                     PROP_ENGINE,
+                                     pspec);
+
+    /**
+     * CattleConfiguration:tape-size:
+     *
+     * Number of cells in the tape, or zero if the tape grows as more
+     * cells are needed.
+     *
+     * Changes to this property are not notified.
+     */
+    pspec = g_param_spec_ulong ("tape-size",
+                                "Number of cells in the tape",
+                                "Get/set tape size",
+                                0,
+                                G_MAXULONG,
+                                0,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property (object_class,
+                                     PROP_TAPE_SIZE,
+                                     pspec);
+
+    /**
+     * CattleConfiguration:bounds-check-is-enabled:
+     *
+     * If %FALSE, moves past either end of a fixed-size tape are not
+     * detected.
+     *
+     * Changes to this property are not notified.
+     */
+    pspec = g_param_spec_boolean ("bounds-check-is-enabled",
+                                  "Whether or not bounds checking is enabled",
+                                  "Get/set bounds checking",
+                                  TRUE,
+                                  G_PARAM_READWRITE);
+    g_object_class_install_property (object_class,
+                                     PROP_BOUNDS_CHECK_IS_ENABLED,
+                                     pspec);
+
+    /**
+     * CattleConfiguration:cell-width:
+     *
+     * Width of the cells in the tape.
+     *
+     * Changes to this property are not notified.
+     */
+    pspec = g_param_spec_enum ("cell-width",
+                               "Width of the cells in the tape",
+                               "Get/set cell width",
+                               CATTLE_TYPE_CELL_WIDTH,
+                               CATTLE_CELL_WIDTH_8,
+                               G_PARAM_READWRITE);
+    g_object_class_install_property (object_class,
+                                     PROP_CELL_WIDTH,
+                                     pspec);
+
+    /**
+     * CattleConfiguration:input-buffer-size:
+     *
+     * Number of values in the buffer bulk input handlers read input
+     * into.
+     *
+     * Changes to this property are not notified.
+     */
+    pspec = g_param_spec_ulong ("input-buffer-size",
+                                "Number of values in the input buffer",
+                                "Get/set input buffer size",
+                                1,
+                                G_MAXULONG,
+                                4096,
+                                G_PARAM_READWRITE);
+    g_object_class_install_property (object_class,
+                                     PROP_INPUT_BUFFER_SIZE,
+                                     pspec);
 }
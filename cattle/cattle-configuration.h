@@ -43,6 +43,20 @@ typedef enum
     CATTLE_END_OF_INPUT_ACTION_DO_NOTHING
 } CattleEndOfInputAction;
 
+typedef enum
+{
+    CATTLE_ENGINE_SWITCH,
+    CATTLE_ENGINE_THREADED,
+    CATTLE_ENGINE_JIT
+} CattleEngine;
+
+typedef enum
+{
+    CATTLE_CELL_WIDTH_8,
+    CATTLE_CELL_WIDTH_16,
+    CATTLE_CELL_WIDTH_32
+} CattleCellWidth;
+
 typedef struct _CattleConfiguration        CattleConfiguration;
 typedef struct _CattleConfigurationClass   CattleConfigurationClass;
 typedef struct _CattleConfigurationPrivate CattleConfigurationPrivate;
@@ -58,15 +72,30 @@ struct _CattleConfigurationClass
     GObjectClass parent;
 };
 
-CattleConfiguration*    cattle_configuration_new                     (void);
-void                    cattle_configuration_set_end_of_input_action (CattleConfiguration    *configuration,
-                                                                      CattleEndOfInputAction  action);
-CattleEndOfInputAction  cattle_configuration_get_end_of_input_action (CattleConfiguration    *configuration);
-void                    cattle_configuration_set_debug_is_enabled    (CattleConfiguration    *configuration,
-                                                                      gboolean                enabled);
-gboolean                cattle_configuration_get_debug_is_enabled    (CattleConfiguration    *configuration);
+CattleConfiguration*    cattle_configuration_new                         (void);
+void                    cattle_configuration_set_end_of_input_action     (CattleConfiguration    *configuration,
+                                                                          CattleEndOfInputAction  action);
+CattleEndOfInputAction  cattle_configuration_get_end_of_input_action     (CattleConfiguration    *configuration);
+void                    cattle_configuration_set_debug_is_enabled        (CattleConfiguration    *configuration,
+                                                                          gboolean                enabled);
+gboolean                cattle_configuration_get_debug_is_enabled        (CattleConfiguration    *configuration);
+void                    cattle_configuration_set_engine                  (CattleConfiguration    *configuration,
+                                                                          CattleEngine            engine);
+CattleEngine            cattle_configuration_get_engine                  (CattleConfiguration    *configuration);
+void                    cattle_configuration_set_tape_size               (CattleConfiguration    *configuration,
+                                                                          gulong                  size);
+gulong                  cattle_configuration_get_tape_size               (CattleConfiguration    *configuration);
+void                    cattle_configuration_set_bounds_check_is_enabled (CattleConfiguration    *configuration,
+                                                                          gboolean                enabled);
+gboolean                cattle_configuration_get_bounds_check_is_enabled (CattleConfiguration    *configuration);
+void                    cattle_configuration_set_cell_width              (CattleConfiguration    *configuration,
+                                                                          CattleCellWidth         width);
+CattleCellWidth         cattle_configuration_get_cell_width              (CattleConfiguration    *configuration);
+void                    cattle_configuration_set_input_buffer_size       (CattleConfiguration    *configuration,
+                                                                          gulong                  size);
+gulong                  cattle_configuration_get_input_buffer_size       (CattleConfiguration    *configuration);
 
-GType                   cattle_configuration_get_type                (void) G_GNUC_CONST;
+GType                   cattle_configuration_get_type                    (void) G_GNUC_CONST;
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (CattleConfiguration, g_object_unref)
 
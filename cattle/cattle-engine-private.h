@@ -0,0 +1,590 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#if !defined (CATTLE_COMPILATION)
+#error "This header is private to Cattle and can't be included directly."
+#endif
+
+/* Execution engines specialized for a single cell width.
+ *
+ * This file is included by cattle-interpreter.c once for each cell
+ * width, with CELL defined as the unsigned type of a cell and
+ * ENGINE(name) defined to give each copy of a function its own name;
+ * both are undefined at the end of the file. There is deliberately no
+ * include guard.
+ *
+ * The engines keep the current cell, along with the range of cells
+ * that have already been reached, in local variables: moving and
+ * updating values inside that range doesn't involve the tape at all,
+ * and since the cell type is known at compile time, the loop for 8 bit
+ * cells is exactly as fast as if it were the only one */
+
+/* Update the tape with the current cell, before calling any function
+ * that uses the tape. A trusted program might have moved past either
+ * end of the tape without touching a guard page along the way: it's
+ * stopped here, before the tape is handed a cell it doesn't own */
+#define SYNC() \
+    G_STMT_START { \
+        if (!cattle_tape_set_current_cell (tape, (gint8 *) current)) \
+        { \
+            set_out_of_bounds_error (error); \
+            \
+            return FALSE; \
+        } \
+    } G_STMT_END
+
+/* Get the current cell and the range of reached cells back from the
+ * tape, which might have grown in the meantime */
+#define LOAD() \
+    G_STMT_START { \
+        current = (CELL *) cattle_tape_get_current_cell (tape, \
+                                                         &reached_first, \
+                                                         &reached_last); \
+        first = (CELL *) reached_first; \
+        last = (CELL *) reached_last; \
+    } G_STMT_END
+
+/* Check whether the cell @offset cells away from @current has already
+ * been reached */
+static inline gboolean
+ENGINE (is_reached) (CELL  *current,
+                     CELL  *first,
+                     CELL  *last,
+                     glong  offset)
+{
+    if (offset < 0)
+    {
+        return ((gulong) -offset <= (gulong) (current - first));
+    }
+
+    return ((gulong) offset <= (gulong) (last - current));
+}
+
+/* Execute the compiled instructions using a plain switch statement
+ * to dispatch operations. It works with any compiler.
+ *
+ * If @checked is %TRUE, the tape has a fixed size and moves are
+ * checked against its bounds: since all of its cells count as reached,
+ * that only needs to happen when leaving the range of reached cells.
+ * Scans are always checked, because they have to look at every cell
+ * along the way anyway.
+ *
+ * If @guard is not zero, the tape is also surrounded by guard pages
+ * spanning at least @guard cells, and the program is trusted never to
+ * leave the tape: moves and offsets that are no longer than that are
+ * not checked at all, since they can't jump over a guard page. If the
+ * program leaves the tape anyway, it behaves just like native code
+ * would: it crashes when it touches a guard page, and is stopped when
+ * it calls back into the tape from outside of it or makes a longer
+ * move */
+static gboolean
+ENGINE (run_switch) (CattleInterpreter  *self,
+                     CattleOp           *ops,
+                     gboolean            checked,
+                     gulong              guard,
+                     GError            **error)
+{
+    CattleTape *tape;
+    CattleOp   *op;
+    CELL       *current;
+    CELL       *first;
+    CELL       *last;
+    gint8      *reached_first;
+    gint8      *reached_last;
+    CELL        amount;
+
+    tape = self->priv->tape;
+    LOAD ();
+
+    op = ops;
+
+    while (op->opcode != CATTLE_OP_END)
+    {
+        switch (op->opcode)
+        {
+            case CATTLE_OP_LOOP_BEGIN:
+
+                /* Skip the loop if the value stored in the current
+                 * cell is zero */
+                if (*current == 0)
+                {
+                    op = ops + op->jump;
+                }
+
+                break;
+
+            case CATTLE_OP_LOOP_END:
+
+                /* Repeat the loop if the value stored in the current
+                 * cell is not zero */
+                if (*current != 0)
+                {
+                    op = ops + op->jump;
+                }
+
+                break;
+
+            case CATTLE_OP_MOVE_LEFT:
+
+                if (G_LIKELY (op->quantity <= (gulong) (current - first) ||
+                              op->quantity <= guard))
+                {
+                    current -= op->quantity;
+
+                    break;
+                }
+
+                SYNC ();
+
+                if (checked)
+                {
+                    set_out_of_bounds_error (error);
+
+                    return FALSE;
+                }
+
+                cattle_tape_move_left_by (tape, op->quantity);
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_MOVE_RIGHT:
+
+                if (G_LIKELY (op->quantity <= (gulong) (last - current) ||
+                              op->quantity <= guard))
+                {
+                    current += op->quantity;
+
+                    break;
+                }
+
+                SYNC ();
+
+                if (checked)
+                {
+                    set_out_of_bounds_error (error);
+
+                    return FALSE;
+                }
+
+                cattle_tape_move_right_by (tape, op->quantity);
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_INCREASE:
+
+                amount = op->quantity;
+
+                if (G_LIKELY (ENGINE (is_reached) (current, first, last, op->offset) ||
+                              (gulong) ABS (op->offset) <= guard))
+                {
+                    current[op->offset] += amount;
+
+                    break;
+                }
+
+                SYNC ();
+
+                if (!add_at_offset (tape, op->offset, amount, checked, error))
+                {
+                    return FALSE;
+                }
+
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_MULTIPLY:
+
+                amount = *current * (CELL) op->quantity;
+
+                if (G_LIKELY (ENGINE (is_reached) (current, first, last, op->offset) ||
+                              (gulong) ABS (op->offset) <= guard))
+                {
+                    current[op->offset] += amount;
+
+                    break;
+                }
+
+                SYNC ();
+
+                if (!add_at_offset (tape, op->offset, amount, checked, error))
+                {
+                    return FALSE;
+                }
+
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_SET_ZERO:
+
+                *current = 0;
+
+                break;
+
+            case CATTLE_OP_SCAN_LEFT:
+
+                SYNC ();
+
+                if (!cattle_tape_scan_left (tape, op->quantity))
+                {
+                    set_out_of_bounds_error (error);
+
+                    return FALSE;
+                }
+
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_SCAN_RIGHT:
+
+                SYNC ();
+
+                if (!cattle_tape_scan_right (tape, op->quantity))
+                {
+                    set_out_of_bounds_error (error);
+
+                    return FALSE;
+                }
+
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_READ:
+
+                SYNC ();
+
+                if (!execute_read (self, op->quantity, error))
+                {
+                    return FALSE;
+                }
+
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_PRINT:
+
+                SYNC ();
+
+                if (!execute_print (self, op->quantity, error))
+                {
+                    return FALSE;
+                }
+
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_DEBUG:
+
+                SYNC ();
+
+                if (!execute_debug (self, op->quantity, error))
+                {
+                    return FALSE;
+                }
+
+                LOAD ();
+
+                break;
+
+            case CATTLE_OP_UNBALANCED:
+
+                SYNC ();
+
+                /* Either a loop was closed without being opened or
+                 * it was never closed */
+                g_set_error_literal (error,
+                                     CATTLE_ERROR,
+                                     CATTLE_ERROR_UNBALANCED_BRACKETS,
+                                     "Unbalanced brackets");
+
+                return FALSE;
+
+            case CATTLE_OP_END:
+
+                /* Never reached */
+
+                break;
+        }
+
+        op++;
+    }
+
+    SYNC ();
+
+    return TRUE;
+}
+
+#ifdef HAVE_COMPUTED_GOTO
+
+/* Jump straight to the code implementing the next operation */
+#define DISPATCH() goto *labels[op->opcode]
+
+/* Execute the compiled instructions by jumping from the code for an
+ * operation directly to the code for the next one, using the labels
+ * as values GNU extension.
+ *
+ * Compared to run_switch(), there is no bounds check and every
+ * operation has its own indirect jump, which the branch predictor can
+ * learn the targets of independently: since Brainfuck programs tend to
+ * have very regular patterns, such as a decrease always being followed
+ * by a loop end, this usually results in far fewer mispredictions.
+ *
+ * See run_switch() for the meaning of @checked and @guard */
+static gboolean
+ENGINE (run_threaded) (CattleInterpreter  *self,
+                       CattleOp           *ops,
+                       gboolean            checked,
+                       gulong              guard,
+                       GError            **error)
+{
+    static const void *labels[] = {
+        [CATTLE_OP_END] = &&op_end,
+        [CATTLE_OP_MOVE_LEFT] = &&op_move_left,
+        [CATTLE_OP_MOVE_RIGHT] = &&op_move_right,
+        [CATTLE_OP_INCREASE] = &&op_increase,
+        [CATTLE_OP_LOOP_BEGIN] = &&op_loop_begin,
+        [CATTLE_OP_LOOP_END] = &&op_loop_end,
+        [CATTLE_OP_READ] = &&op_read,
+        [CATTLE_OP_PRINT] = &&op_print,
+        [CATTLE_OP_DEBUG] = &&op_debug,
+        [CATTLE_OP_SET_ZERO] = &&op_set_zero,
+        [CATTLE_OP_MULTIPLY] = &&op_multiply,
+        [CATTLE_OP_SCAN_LEFT] = &&op_scan_left,
+        [CATTLE_OP_SCAN_RIGHT] = &&op_scan_right,
+        [CATTLE_OP_UNBALANCED] = &&op_unbalanced
+    };
+    CattleTape *tape;
+    CattleOp   *op;
+    CELL       *current;
+    CELL       *first;
+    CELL       *last;
+    gint8      *reached_first;
+    gint8      *reached_last;
+    CELL        amount;
+
+    tape = self->priv->tape;
+    LOAD ();
+
+    op = ops;
+
+    DISPATCH ();
+
+    op_loop_begin:
+
+        /* Skip the loop if the value stored in the current cell is
+         * zero. The jump lands on the matching loop end, which has
+         * to be skipped as well */
+        if (*current == 0)
+        {
+            op = ops + op->jump;
+        }
+        op++;
+        DISPATCH ();
+
+    op_loop_end:
+
+        /* Repeat the loop if the value stored in the current cell is
+         * not zero */
+        if (*current != 0)
+        {
+            op = ops + op->jump;
+        }
+        op++;
+        DISPATCH ();
+
+    op_move_left:
+
+        if (G_UNLIKELY (op->quantity > (gulong) (current - first) &&
+                        op->quantity > guard))
+        {
+            SYNC ();
+
+            if (checked)
+            {
+                set_out_of_bounds_error (error);
+
+                return FALSE;
+            }
+
+            cattle_tape_move_left_by (tape, op->quantity);
+            LOAD ();
+        }
+        else
+        {
+            current -= op->quantity;
+        }
+        op++;
+        DISPATCH ();
+
+    op_move_right:
+
+        if (G_UNLIKELY (op->quantity > (gulong) (last - current) &&
+                        op->quantity > guard))
+        {
+            SYNC ();
+
+            if (checked)
+            {
+                set_out_of_bounds_error (error);
+
+                return FALSE;
+            }
+
+            cattle_tape_move_right_by (tape, op->quantity);
+            LOAD ();
+        }
+        else
+        {
+            current += op->quantity;
+        }
+        op++;
+        DISPATCH ();
+
+    op_increase:
+
+        amount = op->quantity;
+        goto add_amount;
+
+    op_multiply:
+
+        amount = *current * (CELL) op->quantity;
+        goto add_amount;
+
+    add_amount:
+
+        if (G_UNLIKELY (!ENGINE (is_reached) (current, first, last, op->offset) &&
+                        (gulong) ABS (op->offset) > guard))
+        {
+            SYNC ();
+
+            if (!add_at_offset (tape, op->offset, amount, checked, error))
+            {
+                return FALSE;
+            }
+
+            LOAD ();
+        }
+        else
+        {
+            current[op->offset] += amount;
+        }
+        op++;
+        DISPATCH ();
+
+    op_set_zero:
+
+        *current = 0;
+        op++;
+        DISPATCH ();
+
+    op_scan_left:
+
+        SYNC ();
+        if (!cattle_tape_scan_left (tape, op->quantity))
+        {
+            set_out_of_bounds_error (error);
+
+            return FALSE;
+        }
+        LOAD ();
+        op++;
+        DISPATCH ();
+
+    op_scan_right:
+
+        SYNC ();
+        if (!cattle_tape_scan_right (tape, op->quantity))
+        {
+            set_out_of_bounds_error (error);
+
+            return FALSE;
+        }
+        LOAD ();
+        op++;
+        DISPATCH ();
+
+    op_read:
+
+        SYNC ();
+        if (!execute_read (self, op->quantity, error))
+        {
+            return FALSE;
+        }
+        LOAD ();
+        op++;
+        DISPATCH ();
+
+    op_print:
+
+        SYNC ();
+        if (!execute_print (self, op->quantity, error))
+        {
+            return FALSE;
+        }
+        LOAD ();
+        op++;
+        DISPATCH ();
+
+    op_debug:
+
+        SYNC ();
+        if (!execute_debug (self, op->quantity, error))
+        {
+            return FALSE;
+        }
+        LOAD ();
+        op++;
+        DISPATCH ();
+
+    op_unbalanced:
+
+        SYNC ();
+
+        /* Either a loop was closed without being opened or it was
+         * never closed */
+        g_set_error_literal (error,
+                             CATTLE_ERROR,
+                             CATTLE_ERROR_UNBALANCED_BRACKETS,
+                             "Unbalanced brackets");
+
+        return FALSE;
+
+    op_end:
+
+        SYNC ();
+
+        return TRUE;
+}
+
+#undef DISPATCH
+
+#endif /* HAVE_COMPUTED_GOTO */
+
+#undef LOAD
+#undef SYNC
+
+#undef ENGINE
+#undef CELL
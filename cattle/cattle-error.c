@@ -37,6 +37,8 @@
  * brackets don't match
  * @CATTLE_ERROR_INPUT_OUT_OF_RANGE: The input cannot be stored in a
  * tape cell
+ * @CATTLE_ERROR_TAPE_OUT_OF_BOUNDS: The program tried to move past
+ * either end of a fixed-size tape
  *
  * Errors detected either on code loading or at runtime.
  */
@@ -33,7 +33,8 @@ typedef enum
 {
     CATTLE_ERROR_IO,
     CATTLE_ERROR_UNBALANCED_BRACKETS,
-    CATTLE_ERROR_INPUT_OUT_OF_RANGE
+    CATTLE_ERROR_INPUT_OUT_OF_RANGE,
+    CATTLE_ERROR_TAPE_OUT_OF_BOUNDS
 } CattleError;
 
 #define CATTLE_ERROR cattle_error_quark()
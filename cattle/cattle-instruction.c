@@ -127,26 +127,63 @@ static void
 cattle_instruction_dispose (GObject *object)
 {
     CattleInstruction        *self;
+    CattleInstruction        *current;
     CattleInstructionPrivate *priv;
+    GPtrArray                *pending;
 
     self = CATTLE_INSTRUCTION (object);
     priv = self->priv;
 
     g_return_if_fail (!priv->disposed);
 
+    /* Releasing the next instruction, or the first instruction in
+     * the loop, would cause all the following instructions to be
+     * released recursively, one nested call for each of them.
+     *
+     * Instead, the links of instructions that are about to be
+     * finalized are detached and released here, so that programs
+     * of any length can be released using a bounded amount of
+     * stack space */
+    pending = g_ptr_array_new ();
+
     if (priv->next != NULL)
     {
-        g_object_unref (priv->next);
+        g_ptr_array_add (pending, priv->next);
+        priv->next = NULL;
     }
 
     if (priv->loop != NULL)
     {
-        /* Releasing the first instruction in the loop causes
-         * all the instructions in the loop to be released as
-         * well, so we can safely release just the first one */
-        g_object_unref (priv->loop);
+        g_ptr_array_add (pending, priv->loop);
+        priv->loop = NULL;
     }
 
+    while (pending->len > 0)
+    {
+        current = g_ptr_array_remove_index_fast (pending, pending->len - 1);
+
+        /* Only instructions that are not shared with anyone else
+         * are going to be finalized */
+        if (G_OBJECT (current)->ref_count == 1)
+        {
+            if (current->priv->next != NULL)
+            {
+                g_ptr_array_add (pending, current->priv->next);
+                current->priv->next = NULL;
+            }
+
+            if (current->priv->loop != NULL)
+            {
+                g_ptr_array_add (pending, current->priv->loop);
+                current->priv->loop = NULL;
+            }
+        }
+
+        g_object_unref (current);
+    }
+
+    g_ptr_array_free (pending, TRUE);
+
     priv->disposed = TRUE;
 
     G_OBJECT_CLASS (cattle_instruction_parent_class)->dispose (object);
@@ -21,11 +21,19 @@
 #include "cattle-error.h"
 #include "cattle-constants.h"
 #include "cattle-interpreter.h"
+#include "cattle-program-private.h"
+#include "cattle-tape-private.h"
+#include "cattle-jit-private.h"
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 
+/* Labels as values are a GNU extension, also implemented by clang */
+#if defined (__GNUC__)
+#define HAVE_COMPUTED_GOTO 1
+#endif
+
 /**
  * SECTION:cattle-interpreter
  * @short_description: Brainfuck interpreter
@@ -43,7 +51,8 @@
  *
  * Once initialized, a #CattleInterpreter can run the assigned program
  * as many times as needed; the memory tape, however, is not
- * automatically cleared between executions.
+ * automatically cleared between executions. Calling cattle_tape_clear()
+ * on it before each execution is much cheaper than replacing it.
  */
 
 /**
@@ -55,25 +64,36 @@
 
 struct _CattleInterpreterPrivate
 {
-    gboolean             disposed;
-
-    CattleConfiguration *configuration;
-    CattleProgram       *program;
-    CattleTape          *tape;
-
-    CattleInputHandler   input_handler;
-    gpointer             input_handler_data;
-    CattleOutputHandler  output_handler;
-    gpointer             output_handler_data;
-    CattleDebugHandler   debug_handler;
-    gpointer             debug_handler_data;
-
-    GSList              *stack; /* Instruction stack */
-
-    gboolean             had_input;
-    CattleBuffer        *input;
-    gulong               input_offset;
-    gboolean             end_of_input_reached;
+    gboolean                 disposed;
+
+    CattleConfiguration     *configuration;
+    CattleProgram           *program;
+    CattleTape              *tape;
+
+    CattleInputHandler       input_handler;
+    gpointer                 input_handler_data;
+    CattleBulkInputHandler   bulk_input_handler;
+    gpointer                 bulk_input_handler_data;
+    CattleOutputHandler      output_handler;
+    gpointer                 output_handler_data;
+    CattleBulkOutputHandler  bulk_output_handler;
+    gpointer                 bulk_output_handler_data;
+    CattleDebugHandler       debug_handler;
+    gpointer                 debug_handler_data;
+
+    gboolean                 had_input;
+    CattleBuffer            *input;
+    const gint8             *input_data;   /* Contents of the current
+                                            * input */
+    gulong                   input_size;
+    gulong                   input_offset;
+    gboolean                 end_of_input_reached;
+
+    gint8                   *input_buffer; /* Reused for bulk input */
+    gulong                   input_buffer_size;
+
+    gint8                    output[4096]; /* Output not flushed yet */
+    gulong                   output_size;
 };
 
 G_DEFINE_TYPE_WITH_CODE (CattleInterpreter, cattle_interpreter, G_TYPE_OBJECT,
@@ -89,18 +109,22 @@ enum
 };
 
 /* Internal functions */
-static gboolean run                    (CattleInterpreter  *interpreter,
-                                        GError            **error);
-static gboolean default_input_handler  (CattleInterpreter  *interpreter,
-                                        gpointer            data,
-                                        GError            **error);
-static gboolean default_output_handler (CattleInterpreter  *interpreter,
-                                        gint8               output,
-                                        gpointer            data,
-                                        GError            **error);
-static gboolean default_debug_handler  (CattleInterpreter  *interpreter,
-                                        gpointer            data,
-                                        GError            **error);
+static gboolean run                         (CattleInterpreter  *interpreter,
+                                             GError            **error);
+static gboolean default_bulk_input_handler  (CattleInterpreter  *interpreter,
+                                             gint8              *buffer,
+                                             gulong              size,
+                                             gulong             *length,
+                                             gpointer            data,
+                                             GError            **error);
+static gboolean default_bulk_output_handler (CattleInterpreter  *interpreter,
+                                             const gint8        *output,
+                                             gulong              size,
+                                             gpointer            data,
+                                             GError            **error);
+static gboolean default_debug_handler       (CattleInterpreter  *interpreter,
+                                             gpointer            data,
+                                             GError            **error);
 
 static void
 cattle_interpreter_init (CattleInterpreter *self)
@@ -113,18 +137,27 @@ cattle_interpreter_init (CattleInterpreter *self)
 
     self->priv->input_handler = NULL;
     self->priv->input_handler_data = NULL;
+    self->priv->bulk_input_handler = NULL;
+    self->priv->bulk_input_handler_data = NULL;
     self->priv->output_handler = NULL;
     self->priv->output_handler_data = NULL;
+    self->priv->bulk_output_handler = NULL;
+    self->priv->bulk_output_handler_data = NULL;
     self->priv->debug_handler = NULL;
     self->priv->debug_handler_data = NULL;
 
-    self->priv->stack = NULL;
-
     self->priv->had_input = FALSE;
     self->priv->input = NULL;
+    self->priv->input_data = NULL;
+    self->priv->input_size = 0;
     self->priv->input_offset = 0;
     self->priv->end_of_input_reached = FALSE;
 
+    self->priv->input_buffer = NULL;
+    self->priv->input_buffer_size = 0;
+
+    self->priv->output_size = 0;
+
     self->priv->disposed = FALSE;
 }
 
@@ -152,382 +185,842 @@ cattle_interpreter_dispose (GObject *object)
 static void
 cattle_interpreter_finalize (GObject *object)
 {
+    CattleInterpreter *self = CATTLE_INTERPRETER (object);
+
+    g_free (self->priv->input_buffer);
+
     G_OBJECT_CLASS (cattle_interpreter_parent_class)->finalize (object);
 }
 
+/* Report an error raised by a handler. If the handler has set the
+ * error, as it's required to, propagate it; if it hasn't, raise a
+ * generic I/O error */
+static void
+propagate_handler_error (GError **error,
+                         GError  *inner_error)
+{
+    if (inner_error == NULL)
+    {
+        g_set_error_literal (error,
+                             CATTLE_ERROR,
+                             CATTLE_ERROR_IO,
+                             "Unknown I/O error");
+    }
+    else
+    {
+        g_propagate_error (error,
+                           inner_error);
+    }
+}
+
+/* Pass all buffered output to the bulk output handler. This happens
+ * when the buffer is full, before reading input or debugging, so that
+ * the user sees any prompt first, and at the end of a run */
 static gboolean
-run (CattleInterpreter  *self,
-     GError            **error)
+flush_output (CattleInterpreter  *self,
+              GError            **error)
 {
     CattleInterpreterPrivate *priv;
-    CattleConfiguration      *configuration;
-    CattleProgram            *program;
-    CattleTape               *tape;
-    CattleInstruction        *first;
-    CattleInstruction        *current;
-    CattleInstruction        *next;
-    CattleInstructionValue    value;
-    CattleInputHandler        input_handler;
-    CattleOutputHandler       output_handler;
-    CattleDebugHandler        debug_handler;
-    GSList                   *stack;
+    CattleBulkOutputHandler   bulk_output_handler;
     GError                   *inner_error;
     gboolean                  success;
-    gint8                     temp;
-    gulong                    quantity;
     gulong                    size;
+
+    priv = self->priv;
+
+    if (priv->output_size == 0)
+    {
+        return TRUE;
+    }
+
+    bulk_output_handler = priv->bulk_output_handler;
+    if (bulk_output_handler == NULL)
+    {
+        bulk_output_handler = default_bulk_output_handler;
+    }
+
+    /* The buffer is emptied even if the handler fails, so that the
+     * same output is never passed to it twice */
+    size = priv->output_size;
+    priv->output_size = 0;
+
+    inner_error = NULL;
+    success = (*bulk_output_handler) (self,
+                                      priv->output,
+                                      size,
+                                      priv->bulk_output_handler_data,
+                                      &inner_error);
+    success &= (inner_error == NULL);
+
+    if (G_UNLIKELY (success == FALSE))
+    {
+        propagate_handler_error (error, inner_error);
+
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Get more runtime input, either from the input handler, which is
+ * going to feed a buffer to the interpreter, or from the bulk input
+ * handler, which reads it straight into the input buffer. No input
+ * means the end of input has been reached */
+static gboolean
+fetch_input (CattleInterpreter  *self,
+             GError            **error)
+{
+    CattleInterpreterPrivate *priv;
+    CattleBulkInputHandler    bulk_input_handler;
+    GError                   *inner_error;
+    gboolean                  success;
+    gulong                    size;
+    gulong                    length;
+
+    priv = self->priv;
+
+    /* Make sure the user has seen all output so far, as it could be a
+     * prompt for the input being requested */
+    if (!flush_output (self, error))
+    {
+        return FALSE;
+    }
+
+    if (priv->input_handler != NULL)
+    {
+        inner_error = NULL;
+        success = (*priv->input_handler) (self,
+                                          priv->input_handler_data,
+                                          &inner_error);
+        success &= (inner_error == NULL);
+
+        if (G_UNLIKELY (success == FALSE))
+        {
+            propagate_handler_error (error, inner_error);
+
+            return FALSE;
+        }
+
+        return TRUE;
+    }
+
+    bulk_input_handler = priv->bulk_input_handler;
+    if (bulk_input_handler == NULL)
+    {
+        bulk_input_handler = default_bulk_input_handler;
+    }
+
+    /* The input buffer is only reallocated if its size has changed
+     * in the configuration */
+    size = cattle_configuration_get_input_buffer_size (priv->configuration);
+
+    if (priv->input_buffer_size != size)
+    {
+        g_free (priv->input_buffer);
+        priv->input_buffer = g_new (gint8, size);
+        priv->input_buffer_size = size;
+    }
+
+    length = 0;
+
+    inner_error = NULL;
+    success = (*bulk_input_handler) (self,
+                                     priv->input_buffer,
+                                     size,
+                                     &length,
+                                     priv->bulk_input_handler_data,
+                                     &inner_error);
+    success &= (inner_error == NULL);
+
+    if (G_UNLIKELY (success == FALSE))
+    {
+        propagate_handler_error (error, inner_error);
+
+        return FALSE;
+    }
+
+    /* Read values straight from the input buffer from now on */
+    priv->input_data = priv->input_buffer;
+    priv->input_size = MIN (length, size);
+    priv->input_offset = 0;
+
+    return TRUE;
+}
+
+static gboolean
+execute_read (CattleInterpreter  *self,
+              gulong              quantity,
+              GError            **error)
+{
+    CattleInterpreterPrivate *priv;
+    gint8                     temp;
     gulong                    i;
 
     priv = self->priv;
 
-    configuration = priv->configuration;
-    program = priv->program;
-    tape = priv->tape;
+    temp = 0;
+
+    for (i = 0; i < quantity; i++)
+    {
+        /* Read and normalize a value */
+
+        if (!priv->end_of_input_reached &&
+            priv->input_offset >= priv->input_size)
+        {
+            /* Current input consumed */
+
+            if (priv->had_input)
+            {
+                /* Embedded input consumed.
+                 * No more input can be retrieved */
+                priv->end_of_input_reached = TRUE;
+            }
+            else
+            {
+                /* Runtime input consumed.
+                 * Ask for more, and give up if none is retrieved */
+                if (!fetch_input (self, error))
+                {
+                    return FALSE;
+                }
+
+                if (priv->input_offset >= priv->input_size)
+                {
+                    priv->end_of_input_reached = TRUE;
+                }
+            }
+        }
+
+        if (priv->end_of_input_reached)
+        {
+            /* End of input reached.
+             * The value will be CATTLE_EOF both for embedded and
+             * runtime input */
+            temp = CATTLE_EOF;
+        }
+        else
+        {
+            /* Get a value from the current input and move forward */
+            temp = priv->input_data[priv->input_offset];
+            priv->input_offset++;
+        }
+    }
+
+    /* Save the value. Executed only once even when multiple subsequent
+     * read instruction are present in the program */
+
+    if (temp == CATTLE_EOF)
+    {
+        /* End of input.
+         * The new value depends on the configuration */
+        switch (cattle_configuration_get_end_of_input_action (priv->configuration))
+        {
+            case CATTLE_END_OF_INPUT_ACTION_STORE_EOF:
+
+                cattle_tape_set_current_value (priv->tape, temp);
+                break;
 
-    input_handler = priv->input_handler;
-    if (input_handler == NULL)
+            case CATTLE_END_OF_INPUT_ACTION_DO_NOTHING:
+
+                /* Do nothing */
+                break;
+
+            case CATTLE_END_OF_INPUT_ACTION_STORE_ZERO:
+            default:
+
+                cattle_tape_set_current_value (priv->tape, 0);
+                break;
+        }
+    }
+    else
     {
-        input_handler = default_input_handler;
+        /* Not end of input.
+         * Save the new value, which is a byte even if cells are
+         * wider than that */
+        cattle_tape_set_current_wide_value (priv->tape, (guint8) temp);
     }
+
+    return TRUE;
+}
+
+static gboolean
+execute_print (CattleInterpreter  *self,
+               gulong              quantity,
+               GError            **error)
+{
+    CattleInterpreterPrivate *priv;
+    CattleOutputHandler       output_handler;
+    GError                   *inner_error;
+    gboolean                  success;
+    gint8                     value;
+    gulong                    size;
+    gulong                    i;
+
+    priv = self->priv;
+
+    value = cattle_tape_get_current_value (priv->tape);
+
     output_handler = priv->output_handler;
     if (output_handler == NULL)
     {
-        output_handler = default_output_handler;
+        /* Append the value to the output buffer, as many times as
+         * needed, flushing it whenever it gets full */
+        while (quantity > 0)
+        {
+            size = MIN (quantity, sizeof (priv->output) - priv->output_size);
+            memset (priv->output + priv->output_size, value, size);
+            priv->output_size += size;
+            quantity -= size;
+
+            if (priv->output_size == sizeof (priv->output))
+            {
+                if (!flush_output (self, error))
+                {
+                    return FALSE;
+                }
+            }
+        }
+
+        return TRUE;
+    }
+
+    /* Call the output handler once for each value */
+    for (i = 0; i < quantity; i++)
+    {
+        inner_error = NULL;
+        success = (*output_handler) (self,
+                                     value,
+                                     priv->output_handler_data,
+                                     &inner_error);
+        success &= (inner_error == NULL);
+
+        /* Stop at the first error, even if we should output the
+         * content of the current cell more than once */
+        if (G_UNLIKELY (success == FALSE))
+        {
+            propagate_handler_error (error, inner_error);
+
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static gboolean
+execute_debug (CattleInterpreter  *self,
+               gulong              quantity,
+               GError            **error)
+{
+    CattleInterpreterPrivate *priv;
+    CattleDebugHandler        debug_handler;
+    GError                   *inner_error;
+    gboolean                  success;
+    gulong                    i;
+
+    priv = self->priv;
+
+    /* Dump the tape only if debugging is enabled in the
+     * configuration */
+    if (!cattle_configuration_get_debug_is_enabled (priv->configuration))
+    {
+        return TRUE;
     }
+
     debug_handler = priv->debug_handler;
     if (debug_handler == NULL)
     {
         debug_handler = default_debug_handler;
     }
 
-    stack = priv->stack;
-    success = TRUE;
+    /* Keep the output and the debug information in order */
+    if (!flush_output (self, error))
+    {
+        return FALSE;
+    }
+
+    for (i = 0; i < quantity; i++)
+    {
+        inner_error = NULL;
+        success = (*debug_handler) (self,
+                                    priv->debug_handler_data,
+                                    &inner_error);
+        success &= (inner_error == NULL);
+
+        if (G_UNLIKELY (success == FALSE))
+        {
+            propagate_handler_error (error, inner_error);
+
+            return FALSE;
+        }
+    }
 
-    first = cattle_program_get_instructions (program);
-    g_object_ref (first);
+    return TRUE;
+}
 
-    current = first;
+/* Stop a program that tried to move past either end of a fixed-size
+ * tape */
+static void
+set_out_of_bounds_error (GError **error)
+{
+    g_set_error_literal (error,
+                         CATTLE_ERROR,
+                         CATTLE_ERROR_TAPE_OUT_OF_BOUNDS,
+                         "Tape out of bounds");
+}
 
-    while (current != NULL)
+/* Check whether the cell @steps cells to the left of the current one,
+ * or to its right if @left is FALSE, can be reached without moving past
+ * either end of a fixed-size tape */
+static gboolean
+check_bounds (CattleTape  *tape,
+              gulong       steps,
+              gboolean     left,
+              GError     **error)
+{
+    gboolean success;
+
+    if (left)
+    {
+        success = cattle_tape_can_move_left (tape, steps);
+    }
+    else
     {
-        value = cattle_instruction_get_value (current);
+        success = cattle_tape_can_move_right (tape, steps);
+    }
 
-        switch (value)
-        {
-            case CATTLE_INSTRUCTION_LOOP_BEGIN:
+    if (!success)
+    {
+        set_out_of_bounds_error (error);
+    }
 
-                next = cattle_instruction_get_loop (current);
+    return success;
+}
 
-                /* Enter the loop only if the value stored in the
-                 * current cell is not zero */
-                if (cattle_tape_get_current_value (tape) != 0)
-                {
-                    /* Push the current instruction on the stack */
-                    stack = g_slist_prepend (stack, current);
-                    priv->stack = stack;
-                    current = next;
+/* Add @amount to the value @offset cells away from the current one,
+ * which has not been reached yet: the tape is moved there and back so
+ * that it can grow. Fails if @checked is %TRUE, since all cells of a
+ * fixed-size tape count as reached */
+static gboolean
+add_at_offset (CattleTape  *tape,
+               glong        offset,
+               gulong       amount,
+               gboolean     checked,
+               GError     **error)
+{
+    if (checked)
+    {
+        set_out_of_bounds_error (error);
 
-                    continue;
-                }
+        return FALSE;
+    }
 
-                break;
+    if (offset < 0)
+    {
+        cattle_tape_move_left_by (tape, -offset);
+        cattle_tape_increase_current_value_by (tape, amount);
+        cattle_tape_move_right_by (tape, -offset);
+    }
+    else
+    {
+        cattle_tape_move_right_by (tape, offset);
+        cattle_tape_increase_current_value_by (tape, amount);
+        cattle_tape_move_left_by (tape, offset);
+    }
 
-            case CATTLE_INSTRUCTION_LOOP_END:
+    return TRUE;
+}
 
-                /* If the instruction stack is empty, we're not running
-                 * a loop, so trying to exit it is an error */
-                if (G_UNLIKELY (stack == NULL))
-                {
-                    g_set_error_literal (error,
-                                         CATTLE_ERROR,
-                                         CATTLE_ERROR_UNBALANCED_BRACKETS,
-                                         "Unbalanced brackets");
+/* Build an engine for each cell width. See cattle-engine-private.h */
+#define CELL guint8
+#define ENGINE(name) name##_8
+#include "cattle-engine-private.h"
+
+#define CELL guint16
+#define ENGINE(name) name##_16
+#include "cattle-engine-private.h"
+
+#define CELL guint32
+#define ENGINE(name) name##_32
+#include "cattle-engine-private.h"
+
+typedef gboolean (*CattleEngineFunc) (CattleInterpreter  *self,
+                                      CattleOp           *ops,
+                                      gboolean            checked,
+                                      gulong              guard,
+                                      GError            **error);
+
+/* Engines for each cell width, indexed by #CattleCellWidth */
+static const CattleEngineFunc switch_engines[] = {
+    [CATTLE_CELL_WIDTH_8] = run_switch_8,
+    [CATTLE_CELL_WIDTH_16] = run_switch_16,
+    [CATTLE_CELL_WIDTH_32] = run_switch_32
+};
 
-                    g_object_unref (current);
+#ifdef HAVE_COMPUTED_GOTO
+static const CattleEngineFunc threaded_engines[] = {
+    [CATTLE_CELL_WIDTH_8] = run_threaded_8,
+    [CATTLE_CELL_WIDTH_16] = run_threaded_16,
+    [CATTLE_CELL_WIDTH_32] = run_threaded_32
+};
+#endif
 
-                    return FALSE;
-                }
+/* Context passed to native code: the interpreter needs to be
+ * reachable from callbacks */
+typedef struct _CattleInterpreterJitContext CattleInterpreterJitContext;
 
-                /* Pop an instruction off the stack */
-                g_object_unref (current);
-                current = CATTLE_INSTRUCTION (stack->data);
-                stack = g_slist_delete_link (stack, stack);
-                priv->stack = stack;
+struct _CattleInterpreterJitContext
+{
+    CattleJitContext   parent;
 
-                continue;
+    CattleInterpreter *interpreter;
+    GError           **error;
+};
 
-            case CATTLE_INSTRUCTION_MOVE_LEFT:
+/* Update the tape with the current cell used by native code. Fails
+ * if a trusted program has moved past either end of the tape: see
+ * SYNC() in cattle-engine-private.h */
+static gboolean
+jit_sync_to_tape (CattleJitContext *context)
+{
+    CattleInterpreterJitContext *jit_context;
 
-                quantity = cattle_instruction_get_quantity (current);
-                cattle_tape_move_left_by (tape, quantity);
+    jit_context = (CattleInterpreterJitContext *) context;
 
-                break;
+    if (!cattle_tape_set_current_cell (jit_context->interpreter->priv->tape,
+                                       context->current))
+    {
+        set_out_of_bounds_error (jit_context->error);
 
-            case CATTLE_INSTRUCTION_MOVE_RIGHT:
+        return FALSE;
+    }
 
-                quantity = cattle_instruction_get_quantity (current);
-                cattle_tape_move_right_by (tape, quantity);
+    return TRUE;
+}
 
-                break;
+/* Update the current cell used by native code with the tape's */
+static void
+jit_sync_from_tape (CattleJitContext *context)
+{
+    CattleInterpreterJitContext *jit_context;
+
+    jit_context = (CattleInterpreterJitContext *) context;
 
-            case CATTLE_INSTRUCTION_INCREASE:
+    context->current = cattle_tape_get_current_cell (jit_context->interpreter->priv->tape,
+                                                     &(context->first),
+                                                     &(context->last));
+}
 
-                quantity = cattle_instruction_get_quantity (current);
-                cattle_tape_increase_current_value_by (tape, quantity);
+static gboolean
+jit_move_left (CattleJitContext *context,
+               gulong            quantity)
+{
+    CattleInterpreterJitContext *jit_context;
+    CattleTape                  *tape;
 
-                break;
+    jit_context = (CattleInterpreterJitContext *) context;
+    tape = jit_context->interpreter->priv->tape;
 
-            case CATTLE_INSTRUCTION_DECREASE:
+    /* Native code only gets here when moving outside of the range it
+     * knows about, which covers the whole tape if it's fixed-size */
+    if (!jit_sync_to_tape (context) ||
+        !check_bounds (tape, quantity, TRUE, jit_context->error))
+    {
+        return FALSE;
+    }
+    cattle_tape_move_left_by (tape, quantity);
+    jit_sync_from_tape (context);
 
-                quantity = cattle_instruction_get_quantity (current);
-                cattle_tape_decrease_current_value_by (tape, quantity);
+    return TRUE;
+}
 
-                break;
+static gboolean
+jit_move_right (CattleJitContext *context,
+                gulong            quantity)
+{
+    CattleInterpreterJitContext *jit_context;
+    CattleTape                  *tape;
 
-            case CATTLE_INSTRUCTION_READ:
+    jit_context = (CattleInterpreterJitContext *) context;
+    tape = jit_context->interpreter->priv->tape;
 
-                quantity = cattle_instruction_get_quantity (current);
-                temp = 0;
+    /* Native code only gets here when moving outside of the range it
+     * knows about, which covers the whole tape if it's fixed-size */
+    if (!jit_sync_to_tape (context) ||
+        !check_bounds (tape, quantity, FALSE, jit_context->error))
+    {
+        return FALSE;
+    }
+    cattle_tape_move_right_by (tape, quantity);
+    jit_sync_from_tape (context);
 
-                for (i = 0; i < quantity; i++)
-                {
-                    /* Read and normalize a value */
-
-                    if (priv->end_of_input_reached)
-                    {
-                        /* End of input reached.
-                         * The value will be CATTLE_EOF both for embedded and
-                         * runtime input */
-                        temp = CATTLE_EOF;
-                    }
-                    else
-                    {
-                        size = cattle_buffer_get_size (priv->input);
-
-                        if (priv->input_offset < size)
-                        {
-                            /* Current input buffer not consumed.
-                             * Get a value from the buffer and move forward */
-                            temp = cattle_buffer_get_value (priv->input,
-                                                            priv->input_offset);
-                            priv->input_offset++;
-                        }
-                        else
-                        {
-                            /* Current input buffer consumed */
-
-                            if (priv->had_input)
-                            {
-                                /* Embedded input consumed.
-                                 * No more input can be retrieved */
-                                temp = CATTLE_EOF;
-                                priv->end_of_input_reached = TRUE;
-                            }
-                            else
-                            {
-                                /* Runtime input buffer consumed.
-                                 * Call the input handler to obtain a new
-                                 * input buffer */
-                                inner_error = NULL;
-                                success = (*input_handler) (self,
-                                                            priv->input_handler_data,
-                                                            &inner_error);
-                                success &= (inner_error == NULL);
-
-                                /* Handle input errors */
-                                if (G_UNLIKELY (success == FALSE))
-                                {
-                                    /* If the signal handler has set the
-                                     * error, as it's required to,
-                                     * propagate that error; if it hasn't,
-                                     * raise a generic I/O error */
-                                    if (inner_error == NULL)
-                                    {
-                                        g_set_error_literal (error,
-                                                             CATTLE_ERROR,
-                                                             CATTLE_ERROR_IO,
-                                                             "Unknown I/O error");
-                                    }
-                                    else
-                                    {
-                                        g_propagate_error (error,
-                                                           inner_error);
-                                    }
-
-                                    g_object_unref (current);
-
-                                    return FALSE;
-                                }
-
-                                /* Update size of the input buffer */
-                                size = cattle_buffer_get_size (priv->input);
-
-                                if (priv->input_offset < size)
-                                {
-                                    /* Some input was retrieved */
-                                    temp = cattle_buffer_get_value (priv->input,
-                                                                    priv->input_offset);
-                                    priv->input_offset++;
-                                }
-                                else
-                                {
-                                    /* No more available input */
-                                    temp = CATTLE_EOF;
-                                    priv->end_of_input_reached = TRUE;
-                                }
-                            }
-                        }
-                    }
-                }
+    return TRUE;
+}
 
-                /* Save the value. Executed only once even when multiple subsequent
-                 * read instruction are present in the program */
+static gboolean
+jit_scan_left (CattleJitContext *context,
+               gulong            quantity)
+{
+    CattleInterpreterJitContext *jit_context;
+    gboolean                     success;
 
-                if (temp == CATTLE_EOF)
-                {
-                    /* End of input.
-                     * The new value depends on the configuration */
-                    switch (cattle_configuration_get_end_of_input_action (configuration))
-                    {
-                        case CATTLE_END_OF_INPUT_ACTION_STORE_EOF:
+    jit_context = (CattleInterpreterJitContext *) context;
 
-                            cattle_tape_set_current_value (tape, temp);
-                            break;
+    if (!jit_sync_to_tape (context))
+    {
+        return FALSE;
+    }
 
-                        case CATTLE_END_OF_INPUT_ACTION_DO_NOTHING:
+    success = cattle_tape_scan_left (jit_context->interpreter->priv->tape, quantity);
+    jit_sync_from_tape (context);
 
-                            /* Do nothing */
-                            break;
+    if (!success)
+    {
+        set_out_of_bounds_error (jit_context->error);
+    }
 
-                        case CATTLE_END_OF_INPUT_ACTION_STORE_ZERO:
-                        default:
+    return success;
+}
 
-                            cattle_tape_set_current_value (tape, 0);
-                            break;
-                    }
-                }
-                else
-                {
-                    /* Not end of input.
-                     * Save the new value */
-                    cattle_tape_set_current_value (tape, temp);
-                }
+static gboolean
+jit_scan_right (CattleJitContext *context,
+                gulong            quantity)
+{
+    CattleInterpreterJitContext *jit_context;
+    gboolean                     success;
 
-                break;
+    jit_context = (CattleInterpreterJitContext *) context;
 
-            case CATTLE_INSTRUCTION_PRINT:
+    if (!jit_sync_to_tape (context))
+    {
+        return FALSE;
+    }
 
-                quantity = cattle_instruction_get_quantity (current);
+    success = cattle_tape_scan_right (jit_context->interpreter->priv->tape, quantity);
+    jit_sync_from_tape (context);
 
-                /* Write the value in the current cell to standard
-                 * output */
-                for (i = 0; i < quantity; i++)
-                {
-                    inner_error = NULL;
-                    success = (*output_handler) (self,
-                                                 cattle_tape_get_current_value (tape),
-                                                 priv->output_handler_data,
-                                                 &inner_error);
-                    success &= (inner_error == NULL);
-
-                    /* Stop at the first error, even if we should
-                     * output the content of the current cell more
-                     * than once */
-                    if (G_UNLIKELY (success == FALSE))
-                    {
-                        /* If the signal handler has set the error,
-                         * propagate it; otherwise, raise a generic
-                         * I/O error */
-                        if (inner_error == NULL)
-                        {
-                            g_set_error_literal (error,
-                                                 CATTLE_ERROR,
-                                                 CATTLE_ERROR_IO,
-                                                 "Unknown I/O error");
-                        }
-                        else
-                        {
-                            g_propagate_error (error,
-                                               inner_error);
-                        }
-
-                        g_object_unref (current);
-
-                        return FALSE;
-                    }
-                }
+    if (!success)
+    {
+        set_out_of_bounds_error (jit_context->error);
+    }
 
-                break;
+    return success;
+}
+
+static gboolean
+jit_read (CattleJitContext *context,
+          gulong            quantity)
+{
+    CattleInterpreterJitContext *jit_context;
+    gboolean                     success;
 
-            case CATTLE_INSTRUCTION_DEBUG:
+    jit_context = (CattleInterpreterJitContext *) context;
 
-                /* Dump the tape only if debugging is enabled in the
-                 * configuration */
-                if (cattle_configuration_get_debug_is_enabled (configuration))
-                {
-                    quantity = cattle_instruction_get_quantity (current);
-
-                    for (i = 0; i < quantity; i++)
-                    {
-                        inner_error = NULL;
-                        success = (*debug_handler) (self,
-                                                    priv->debug_handler_data,
-                                                    &inner_error);
-                        success &= (inner_error == NULL);
-
-                        if (G_UNLIKELY (success == FALSE))
-                        {
-                            /* If the debug handler hasn't set the
-                             * error, raise a generic I/O error */
-                            if (inner_error == NULL)
-                            {
-                                g_set_error_literal (error,
-                                                     CATTLE_ERROR,
-                                                     CATTLE_ERROR_IO,
-                                                     "Unknown I/O error");
-                            }
-                            else
-                            {
-                                g_propagate_error (error,
-                                                   inner_error);
-                            }
-
-                            g_object_unref (current);
-
-                            return FALSE;
-                        }
-                    }
-                }
+    if (!jit_sync_to_tape (context))
+    {
+        return FALSE;
+    }
 
-                break;
+    success = execute_read (jit_context->interpreter,
+                            quantity,
+                            jit_context->error);
+    jit_sync_from_tape (context);
 
-            case CATTLE_INSTRUCTION_NONE:
+    return success;
+}
 
-                /* Do nothing */
+static gboolean
+jit_print (CattleJitContext *context,
+           gulong            quantity)
+{
+    CattleInterpreterJitContext *jit_context;
+    gboolean                     success;
 
-                break;
-        }
+    jit_context = (CattleInterpreterJitContext *) context;
 
-        next = cattle_instruction_get_next (current);
-        g_object_unref (current);
-        current = next;
+    if (!jit_sync_to_tape (context))
+    {
+        return FALSE;
     }
 
-    g_object_unref (first);
+    success = execute_print (jit_context->interpreter,
+                             quantity,
+                             jit_context->error);
+    jit_sync_from_tape (context);
+
+    return success;
+}
+
+static gboolean
+jit_debug (CattleJitContext *context,
+           gulong            quantity)
+{
+    CattleInterpreterJitContext *jit_context;
+    gboolean                     success;
+
+    jit_context = (CattleInterpreterJitContext *) context;
 
-    /* There are some instructions left on the stack: the brackets
-     * are not balanced */
-    if (stack != NULL)
+    if (!jit_sync_to_tape (context))
     {
+        return FALSE;
+    }
+
+    success = execute_debug (jit_context->interpreter,
+                             quantity,
+                             jit_context->error);
+    jit_sync_from_tape (context);
+
+    return success;
+}
+
+/* Execute native code generated from the compiled instructions */
+static gboolean
+run_native (CattleInterpreter  *self,
+            CattleJitCode      *native,
+            GError            **error)
+{
+    CattleInterpreterJitContext context;
+    CattleJitStatus             status;
+
+    context.interpreter = self;
+    context.error = error;
+
+    context.parent.move_left = jit_move_left;
+    context.parent.move_right = jit_move_right;
+    context.parent.scan_left = jit_scan_left;
+    context.parent.scan_right = jit_scan_right;
+    context.parent.read = jit_read;
+    context.parent.print = jit_print;
+    context.parent.debug = jit_debug;
+
+    jit_sync_from_tape (&(context.parent));
+
+    status = cattle_jit_run (native, &(context.parent));
+
+    /* Callbacks update the tape before they get a chance to fail, so
+     * that only needs to happen here if none of them did */
+    if (status != CATTLE_JIT_STATUS_FAILED &&
+        !jit_sync_to_tape (&(context.parent)))
+    {
+        return FALSE;
+    }
+
+    if (status == CATTLE_JIT_STATUS_UNBALANCED)
+    {
+        /* Either a loop was closed without being opened or it was
+         * never closed */
         g_set_error_literal (error,
                              CATTLE_ERROR,
                              CATTLE_ERROR_UNBALANCED_BRACKETS,
                              "Unbalanced brackets");
+    }
+
+    /* If a callback failed, the error has already been set */
+    return (status == CATTLE_JIT_STATUS_SUCCESS);
+}
+
+static gboolean
+run (CattleInterpreter  *self,
+     GError            **error)
+{
+    CattleInterpreterPrivate *priv;
+    CattleBytecode           *bytecode;
+    CattleJitCode            *native;
+    CattleEngine              engine;
+    CattleCellWidth           width;
+    gulong                    size;
+    gboolean                  checked;
+    gulong                    guard;
+    gboolean                  success;
+
+    priv = self->priv;
+
+    width = cattle_configuration_get_cell_width (priv->configuration);
+    cattle_tape_set_cell_width (priv->tape, width);
+
+    /* Allocate the whole tape in advance if it has a fixed size */
+    size = cattle_configuration_get_tape_size (priv->configuration);
+
+    if (!cattle_tape_set_size (priv->tape, size))
+    {
+        g_set_error_literal (error,
+                             CATTLE_ERROR,
+                             CATTLE_ERROR_TAPE_OUT_OF_BOUNDS,
+                             "Tape larger than the configured size");
 
         return FALSE;
     }
 
-    return TRUE;
+    /* Moves only need to be checked if the tape can't grow. When
+     * bounds checking is disabled, the program is trusted not to move
+     * past either end of the tape, and moves are not checked as long
+     * as the guard pages around the tape would stop it if it did: that
+     * rules out moves long enough to jump over them, and tapes that
+     * couldn't be mapped at all, which are still checked */
+    checked = (size > 0);
+    guard = 0;
+
+    if (checked &&
+        !cattle_configuration_get_bounds_check_is_enabled (priv->configuration))
+    {
+        guard = cattle_tape_get_guard_size (priv->tape);
+    }
+
+    /* Execute the compiled instructions rather than walking the
+     * instruction objects, which is much slower */
+    bytecode = cattle_program_get_bytecode (priv->program);
+
+    engine = cattle_configuration_get_engine (priv->configuration);
+    native = NULL;
+
+    /* Fall back to the threaded engine if native code is not
+     * available. It's only generated for 8 bit cells */
+    if (engine == CATTLE_ENGINE_JIT)
+    {
+        if (width == CATTLE_CELL_WIDTH_8)
+        {
+            native = cattle_bytecode_get_native (bytecode, guard > 0);
+        }
+
+        if (native == NULL)
+        {
+            engine = CATTLE_ENGINE_THREADED;
+        }
+    }
+
+#ifndef HAVE_COMPUTED_GOTO
+    /* Fall back to the switch-based engine if threaded dispatch is
+     * not supported by the compiler */
+    if (engine == CATTLE_ENGINE_THREADED)
+    {
+        engine = CATTLE_ENGINE_SWITCH;
+    }
+#endif
+
+    switch (engine)
+    {
+        case CATTLE_ENGINE_JIT:
+
+            success = run_native (self, native, error);
+            break;
+
+#ifdef HAVE_COMPUTED_GOTO
+        case CATTLE_ENGINE_THREADED:
+
+            success = threaded_engines[width] (self, bytecode->ops, checked, guard, error);
+            break;
+#endif
+
+        case CATTLE_ENGINE_SWITCH:
+        default:
+
+            success = switch_engines[width] (self, bytecode->ops, checked, guard, error);
+            break;
+    }
+
+    cattle_bytecode_unref (bytecode);
+
+    return success;
 }
 
 /**
@@ -571,8 +1064,10 @@ cattle_interpreter_run (CattleInterpreter  *self,
 
     /* Setup input */
     priv->input = cattle_program_get_input (program);
+    priv->input_data = cattle_buffer_peek_contents (priv->input);
+    priv->input_size = cattle_buffer_get_size (priv->input);
 
-    if (cattle_buffer_get_size (priv->input) > 0)
+    if (priv->input_size > 0)
     {
         priv->had_input = TRUE;
     }
@@ -583,16 +1078,20 @@ cattle_interpreter_run (CattleInterpreter  *self,
     priv->input_offset = 0;
     priv->end_of_input_reached = FALSE;
 
-    /* Setup stack */
-    priv->stack = NULL;
-
     /* Run program */
+    priv->output_size = 0;
     success = run (self, error);
 
-    /* Cleanup stack */
-    if (priv->stack != NULL)
+    /* Flush any output left in the buffer. If the program has failed,
+     * the output it has produced is still flushed, but the error
+     * reported is the one that caused the failure */
+    if (success)
+    {
+        success = flush_output (self, error);
+    }
+    else
     {
-        g_slist_free (priv->stack);
+        flush_output (self, NULL);
     }
 
     /* Cleanup input */
@@ -631,6 +1130,8 @@ cattle_interpreter_feed (CattleInterpreter *self,
     priv->input = input;
     g_object_ref (priv->input);
 
+    priv->input_data = cattle_buffer_peek_contents (priv->input);
+    priv->input_size = cattle_buffer_get_size (priv->input);
     priv->input_offset = 0;
     priv->end_of_input_reached = FALSE;
 }
@@ -822,6 +1323,11 @@ cattle_interpreter_get_tape (CattleInterpreter *self)
  * The handler will be invoked every time @interpreter needs to perform
  * an input action; if @handler is %NULL, the default input handler will
  * be used.
+ *
+ * Setting an input handler replaces any bulk input handler set using
+ * cattle_interpreter_set_bulk_input_handler(). Since the handler has to
+ * allocate a new #CattleBuffer for each chunk of input, a bulk input
+ * handler should be preferred whenever possible.
  */
 void
 cattle_interpreter_set_input_handler (CattleInterpreter  *self,
@@ -838,6 +1344,64 @@ cattle_interpreter_set_input_handler (CattleInterpreter  *self,
 
     priv->input_handler = handler;
     priv->input_handler_data = user_data;
+    priv->bulk_input_handler = NULL;
+    priv->bulk_input_handler_data = NULL;
+}
+
+/**
+ * CattleBulkInputHandler:
+ * @interpreter: a #CattleInterpreter
+ * @buffer: (array length=size): buffer to store input into
+ * @size: maximum number of values to store in @buffer
+ * @length: (out): return location for the number of values stored
+ * @data: user data passed to the handler
+ * @error: return location for a #GError
+ *
+ * Handler for an input operation that reads input directly into a
+ * buffer owned by the interpreter.
+ *
+ * Storing zero values signals the end of input.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ */
+
+/**
+ * cattle_interpreter_set_bulk_input_handler:
+ * @interpreter: a #CattleInterpreter
+ * @handler: (scope notified) (allow-none): bulk input handler, or %NULL
+ * @user_data: (allow-none): user data for @handler
+ *
+ * Set the bulk input handler for @interpreter.
+ *
+ * The handler will be invoked every time @interpreter has consumed all
+ * the input retrieved so far and needs more; if @handler is %NULL, the
+ * default input handler will be used.
+ *
+ * Input is stored in a buffer that is allocated once and reused for
+ * the whole lifetime of @interpreter, so there is no need to call
+ * cattle_interpreter_feed(). Its size can be changed using
+ * cattle_configuration_set_input_buffer_size().
+ *
+ * Setting a bulk input handler replaces any input handler set using
+ * cattle_interpreter_set_input_handler().
+ */
+void
+cattle_interpreter_set_bulk_input_handler (CattleInterpreter      *self,
+                                           CattleBulkInputHandler  handler,
+                                           gpointer                user_data)
+{
+    CattleInterpreterPrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_INTERPRETER (self));
+
+    priv = self->priv;
+
+    g_return_if_fail (!priv->disposed);
+
+    priv->input_handler = NULL;
+    priv->input_handler_data = NULL;
+    priv->bulk_input_handler = handler;
+    priv->bulk_input_handler_data = user_data;
 }
 
 /**
@@ -863,6 +1427,11 @@ cattle_interpreter_set_input_handler (CattleInterpreter  *self,
  * The handler will be invoked every time @interpreter needs to perform
  * an output action; if @handler is %NULL, the default output handler will
  * be used.
+ *
+ * Setting an output handler replaces any bulk output handler set
+ * using cattle_interpreter_set_bulk_output_handler(). Since the handler
+ * is invoked once for each value, a bulk output handler should be
+ * preferred whenever possible.
  */
 void
 cattle_interpreter_set_output_handler (CattleInterpreter   *self,
@@ -879,6 +1448,57 @@ cattle_interpreter_set_output_handler (CattleInterpreter   *self,
 
     priv->output_handler = handler;
     priv->output_handler_data = user_data;
+    priv->bulk_output_handler = NULL;
+    priv->bulk_output_handler_data = NULL;
+}
+
+/**
+ * CattleBulkOutputHandler:
+ * @interpreter: a #CattleInterpreter
+ * @output: (array length=size): the values to output
+ * @size: number of values in @output
+ * @data: user data passed to the handler
+ * @error: return location for a #GError
+ *
+ * Handler for a sequence of output operations.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise
+ */
+
+/**
+ * cattle_interpreter_set_bulk_output_handler:
+ * @interpreter: a #CattleInterpreter
+ * @handler: (scope notified) (allow-none): bulk output handler, or %NULL
+ * @user_data: (allow-none): user data for @handler
+ *
+ * Set the bulk output handler for @interpreter.
+ *
+ * Output is collected by @interpreter in an internal buffer, and the
+ * handler is invoked with all the values in it when the buffer is
+ * full, before any input is requested or debug action is performed,
+ * and at the end of cattle_interpreter_run(); if @handler is %NULL,
+ * the default output handler will be used.
+ *
+ * Setting a bulk output handler replaces any output handler set using
+ * cattle_interpreter_set_output_handler().
+ */
+void
+cattle_interpreter_set_bulk_output_handler (CattleInterpreter       *self,
+                                            CattleBulkOutputHandler  handler,
+                                            gpointer                 user_data)
+{
+    CattleInterpreterPrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_INTERPRETER (self));
+
+    priv = self->priv;
+
+    g_return_if_fail (!priv->disposed);
+
+    priv->output_handler = NULL;
+    priv->output_handler_data = NULL;
+    priv->bulk_output_handler = handler;
+    priv->bulk_output_handler_data = user_data;
 }
 
 /**
@@ -922,55 +1542,67 @@ cattle_interpreter_set_debug_handler (CattleInterpreter  *self,
 }
 
 static gboolean
-default_input_handler (CattleInterpreter  *self,
-                       gpointer            data G_GNUC_UNUSED,
-                       GError            **error)
+default_bulk_input_handler (CattleInterpreter  *self G_GNUC_UNUSED,
+                            gint8              *buffer,
+                            gulong              size,
+                            gulong             *length,
+                            gpointer            data G_GNUC_UNUSED,
+                            GError            **error)
 {
-    CattleBuffer *input;
-    gint8         buffer[256];
-    gssize        size;
+    gssize got;
 
-    size = read (0, buffer, 256);
+    do
+    {
+        got = read (0, buffer, size);
+    }
+    while (G_UNLIKELY (got < 0 && errno == EINTR));
 
-    if (size < 0)
+    if (got < 0)
     {
         g_set_error_literal (error,
-                     CATTLE_ERROR,
-                     CATTLE_ERROR_IO,
-                     strerror (errno));
+                             CATTLE_ERROR,
+                             CATTLE_ERROR_IO,
+                             strerror (errno));
 
         return FALSE;
     }
 
-    /* Copy the contents to a buffer */
-    input = cattle_buffer_new ((gulong) size);
-    cattle_buffer_set_contents (input, (gint8 *) buffer);
-
-    /* Feed the buffer to the interpreter */
-    cattle_interpreter_feed (self, input);
-
-    g_object_unref (input);
+    *length = (gulong) got;
 
     return TRUE;
 }
 
 static gboolean
-default_output_handler (CattleInterpreter  *self G_GNUC_UNUSED,
-                        gint8               output,
-                        gpointer            data G_GNUC_UNUSED,
-                        GError            **error)
+default_bulk_output_handler (CattleInterpreter  *self G_GNUC_UNUSED,
+                             const gint8        *output,
+                             gulong              size,
+                             gpointer            data G_GNUC_UNUSED,
+                             GError            **error)
 {
-    gint8 buffer[1];
-
-    buffer[0] = output;
+    gssize written;
 
-    if (G_UNLIKELY (write (1, buffer, 1) < 0))
+    /* Keep writing until the whole buffer is out, since write() is
+     * allowed to stop short of it */
+    while (size > 0)
     {
-        g_set_error_literal (error,
-                             CATTLE_ERROR,
-                             CATTLE_ERROR_IO,
-                             strerror (errno));
-        return FALSE;
+        written = write (1, output, size);
+
+        if (G_UNLIKELY (written < 0))
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            g_set_error_literal (error,
+                                 CATTLE_ERROR,
+                                 CATTLE_ERROR_IO,
+                                 strerror (errno));
+            return FALSE;
+        }
+
+        output += written;
+        size -= written;
     }
 
     return TRUE;
@@ -981,32 +1613,40 @@ default_debug_handler (CattleInterpreter  *self,
                        gpointer            data G_GNUC_UNUSED,
                        GError            **error)
 {
-    CattleTape *tape;
-    gint8       buffer[4];
-    gint8       value;
-    gulong      size;
-    gulong      steps;
+    CattleTape         *tape;
+    CattleTapePosition  position;
+    gint8               buffer[11];
+    guint32             value;
+    guint32             mask;
+    gulong              size;
+    gulong              steps;
 
     tape = cattle_interpreter_get_tape (self);
 
-    /* Save the current position so it can be restored later */
-    cattle_tape_push_bookmark (tape);
-
-    /* Move to the beginning of the tape, counting how many steps
-     * it takes to get there. This value will be used later to mark
-     * the current position */
-    steps = 0;
-    while (TRUE)
+    /* Values are printed as unsigned numbers of the cell width */
+    switch (cattle_configuration_get_cell_width (self->priv->configuration))
     {
-        if (cattle_tape_is_at_beginning (tape))
-        {
+        case CATTLE_CELL_WIDTH_16:
+            mask = G_MAXUINT16;
+            break;
+        case CATTLE_CELL_WIDTH_32:
+            mask = G_MAXUINT32;
+            break;
+        case CATTLE_CELL_WIDTH_8:
+        default:
+            mask = G_MAXUINT8;
             break;
-        }
-
-        cattle_tape_move_left (tape);
-        steps++;
     }
 
+    /* Save the current position so it can be restored later */
+    cattle_tape_save_position (tape, &position);
+
+    /* Move to the beginning of the tape, remembering how far away
+     * it is. This value will be used later to mark the current
+     * position */
+    steps = cattle_tape_get_position (tape);
+    cattle_tape_move_left_by (tape, steps);
+
     buffer[0] = '[';
     if (G_UNLIKELY (write (2, buffer, 1) < 0))
     {
@@ -1015,7 +1655,7 @@ default_debug_handler (CattleInterpreter  *self,
                              CATTLE_ERROR_IO,
                              strerror (errno));
 
-        cattle_tape_pop_bookmark (tape);
+        cattle_tape_restore_position (tape, &position);
         g_object_unref (tape);
 
         return FALSE;
@@ -1034,18 +1674,18 @@ default_debug_handler (CattleInterpreter  *self,
                                      CATTLE_ERROR_IO,
                                      strerror (errno));
 
-                cattle_tape_pop_bookmark (tape);
+                cattle_tape_restore_position (tape, &position);
                 g_object_unref (tape);
 
                 return FALSE;
             }
         }
 
-        value = cattle_tape_get_current_value (tape);
+        value = cattle_tape_get_current_wide_value (tape) & mask;
 
         /* Print the value of the current cell if it is a graphical char;
          * otherwise, print its hexadecimal value */
-        if (g_ascii_isgraph ((gchar) value))
+        if (value < 128 && g_ascii_isgraph ((gchar) value))
         {
             buffer[0] = value;
             if (G_UNLIKELY (write (2, buffer, 1) < 0))
@@ -1055,14 +1695,14 @@ default_debug_handler (CattleInterpreter  *self,
                                      CATTLE_ERROR_IO,
                                      strerror (errno));
 
-                cattle_tape_pop_bookmark (tape);
+                cattle_tape_restore_position (tape, &position);
                 g_object_unref (tape);
 
                 return FALSE;
             }
         }
         else {
-            size = snprintf ((gchar *) buffer, 4, "0x%X", value);
+            size = snprintf ((gchar *) buffer, 11, "0x%X", value);
 
             if (G_UNLIKELY (write (2, buffer, size) < 0)) {
                 g_set_error_literal (error,
@@ -1070,7 +1710,7 @@ default_debug_handler (CattleInterpreter  *self,
                                      CATTLE_ERROR_IO,
                                      strerror (errno));
 
-                cattle_tape_pop_bookmark (tape);
+                cattle_tape_restore_position (tape, &position);
                 g_object_unref (tape);
 
                 return FALSE;
@@ -1088,7 +1728,7 @@ default_debug_handler (CattleInterpreter  *self,
                                      CATTLE_ERROR_IO,
                                      strerror (errno));
 
-                cattle_tape_pop_bookmark (tape);
+                cattle_tape_restore_position (tape, &position);
                 g_object_unref (tape);
 
                 return FALSE;
@@ -1110,7 +1750,7 @@ default_debug_handler (CattleInterpreter  *self,
                                  CATTLE_ERROR_IO,
                                  strerror (errno));
 
-            cattle_tape_pop_bookmark (tape);
+            cattle_tape_restore_position (tape, &position);
             g_object_unref (tape);
 
             return FALSE;
@@ -1127,7 +1767,7 @@ default_debug_handler (CattleInterpreter  *self,
                              CATTLE_ERROR_IO,
                              strerror (errno));
 
-        cattle_tape_pop_bookmark (tape);
+        cattle_tape_restore_position (tape, &position);
         g_object_unref (tape);
 
         return FALSE;
@@ -1141,14 +1781,14 @@ default_debug_handler (CattleInterpreter  *self,
                              CATTLE_ERROR_IO,
                              strerror (errno));
 
-        cattle_tape_pop_bookmark (tape);
+        cattle_tape_restore_position (tape, &position);
         g_object_unref (tape);
 
         return FALSE;
     }
 
     /* Restore the previously-saved position */
-    cattle_tape_pop_bookmark (tape);
+    cattle_tape_restore_position (tape, &position);
 
     g_object_unref (tape);
 
@@ -54,42 +54,59 @@ struct _CattleInterpreterClass
     GObjectClass parent;
 };
 
-typedef gboolean (*CattleInputHandler)  (CattleInterpreter  *interpreter,
-                                         gpointer            data,
-                                         GError            **error);
-typedef gboolean (*CattleOutputHandler) (CattleInterpreter  *interpreter,
-                                         gint8               output,
-                                         gpointer            data,
-                                         GError            **error);
-typedef gboolean (*CattleDebugHandler)  (CattleInterpreter  *interpreter,
-                                         gpointer            data,
-                                         GError            **error);
+typedef gboolean (*CattleInputHandler)      (CattleInterpreter  *interpreter,
+                                             gpointer            data,
+                                             GError            **error);
+typedef gboolean (*CattleBulkInputHandler)  (CattleInterpreter  *interpreter,
+                                             gint8              *buffer,
+                                             gulong              size,
+                                             gulong             *length,
+                                             gpointer            data,
+                                             GError            **error);
+typedef gboolean (*CattleOutputHandler)     (CattleInterpreter  *interpreter,
+                                             gint8               output,
+                                             gpointer            data,
+                                             GError            **error);
+typedef gboolean (*CattleBulkOutputHandler) (CattleInterpreter  *interpreter,
+                                             const gint8        *output,
+                                             gulong              size,
+                                             gpointer            data,
+                                             GError            **error);
+typedef gboolean (*CattleDebugHandler)      (CattleInterpreter  *interpreter,
+                                             gpointer            data,
+                                             GError            **error);
 
-CattleInterpreter*   cattle_interpreter_new                (void);
-gboolean             cattle_interpreter_run                (CattleInterpreter    *interpreter,
-                                                            GError              **error);
-void                 cattle_interpreter_feed               (CattleInterpreter    *interpreter,
-                                                            CattleBuffer         *input);
-void                 cattle_interpreter_set_configuration  (CattleInterpreter    *interpreter,
-                                                            CattleConfiguration  *configuration);
-CattleConfiguration* cattle_interpreter_get_configuration  (CattleInterpreter    *interpreter);
-void                 cattle_interpreter_set_program        (CattleInterpreter    *interpreter,
-                                                            CattleProgram        *program);
-CattleProgram*       cattle_interpreter_get_program        (CattleInterpreter    *interpreter);
-void                 cattle_interpreter_set_tape           (CattleInterpreter    *interpreter,
-                                                            CattleTape           *tape);
-CattleTape*          cattle_interpreter_get_tape           (CattleInterpreter    *interpreter);
-void                 cattle_interpreter_set_input_handler  (CattleInterpreter    *interpreter,
-                                                            CattleInputHandler    handler,
-                                                            gpointer              user_data);
-void                 cattle_interpreter_set_output_handler (CattleInterpreter    *interpreter,
-                                                            CattleOutputHandler   handler,
-                                                            gpointer              user_data);
-void                 cattle_interpreter_set_debug_handler  (CattleInterpreter    *interpreter,
-                                                            CattleInputHandler    handler,
-                                                            gpointer              user_data);
+CattleInterpreter*   cattle_interpreter_new                     (void);
+gboolean             cattle_interpreter_run                     (CattleInterpreter        *interpreter,
+                                                                 GError                  **error);
+void                 cattle_interpreter_feed                    (CattleInterpreter        *interpreter,
+                                                                 CattleBuffer             *input);
+void                 cattle_interpreter_set_configuration       (CattleInterpreter        *interpreter,
+                                                                 CattleConfiguration      *configuration);
+CattleConfiguration* cattle_interpreter_get_configuration       (CattleInterpreter        *interpreter);
+void                 cattle_interpreter_set_program             (CattleInterpreter        *interpreter,
+                                                                 CattleProgram            *program);
+CattleProgram*       cattle_interpreter_get_program             (CattleInterpreter        *interpreter);
+void                 cattle_interpreter_set_tape                (CattleInterpreter        *interpreter,
+                                                                 CattleTape               *tape);
+CattleTape*          cattle_interpreter_get_tape                (CattleInterpreter        *interpreter);
+void                 cattle_interpreter_set_input_handler       (CattleInterpreter        *interpreter,
+                                                                 CattleInputHandler        handler,
+                                                                 gpointer                  user_data);
+void                 cattle_interpreter_set_bulk_input_handler  (CattleInterpreter        *interpreter,
+                                                                 CattleBulkInputHandler    handler,
+                                                                 gpointer                  user_data);
+void                 cattle_interpreter_set_output_handler      (CattleInterpreter        *interpreter,
+                                                                 CattleOutputHandler       handler,
+                                                                 gpointer                  user_data);
+void                 cattle_interpreter_set_bulk_output_handler (CattleInterpreter        *interpreter,
+                                                                 CattleBulkOutputHandler   handler,
+                                                                 gpointer                  user_data);
+void                 cattle_interpreter_set_debug_handler       (CattleInterpreter        *interpreter,
+                                                                 CattleInputHandler        handler,
+                                                                 gpointer                  user_data);
 
-GType                cattle_interpreter_get_type          (void) G_GNUC_CONST;
+GType                cattle_interpreter_get_type                (void) G_GNUC_CONST;
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (CattleInterpreter, g_object_unref)
 
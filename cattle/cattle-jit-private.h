@@ -0,0 +1,71 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#if !defined (CATTLE_COMPILATION)
+#error "This header is private to Cattle and can't be included directly."
+#endif
+
+#ifndef __CATTLE_JIT_PRIVATE_H__
+#define __CATTLE_JIT_PRIVATE_H__
+
+#include <glib.h>
+#include "cattle-bytecode-private.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CattleJitContext CattleJitContext;
+
+/* Called by native code for operations it can't perform on its own.
+ * Returning FALSE stops the execution */
+typedef gboolean (*CattleJitCallback) (CattleJitContext *context,
+                                       gulong            quantity);
+
+/* State shared between native code and its caller. The layout is
+ * known to the code generator, so fields must not be reordered */
+struct _CattleJitContext
+{
+    gint8             *current;    /* Current cell */
+    gint8             *first;      /* First cell native code can move to */
+    gint8             *last;       /* Last cell native code can move to */
+
+    CattleJitCallback  move_left;  /* Move outside of [first,last] */
+    CattleJitCallback  move_right;
+    CattleJitCallback  scan_left;  /* Scan for a zero */
+    CattleJitCallback  scan_right;
+    CattleJitCallback  read;
+    CattleJitCallback  print;
+    CattleJitCallback  debug;
+};
+
+typedef enum
+{
+    CATTLE_JIT_STATUS_SUCCESS,    /* The program ran to completion */
+    CATTLE_JIT_STATUS_FAILED,     /* A callback returned FALSE */
+    CATTLE_JIT_STATUS_UNBALANCED  /* Unbalanced brackets were found */
+} CattleJitStatus;
+
+CattleJitCode*  cattle_jit_compile (CattleBytecode   *bytecode,
+                                    gboolean          trusted);
+CattleJitStatus cattle_jit_run     (CattleJitCode    *code,
+                                    CattleJitContext *context);
+void            cattle_jit_free    (CattleJitCode    *code);
+
+G_END_DECLS
+
+#endif /* __CATTLE_JIT_PRIVATE_H__ */
@@ -0,0 +1,656 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#include "cattle-jit-private.h"
+
+/* The JIT translates bytecode to native machine code, which is then
+ * called directly by the interpreter.
+ *
+ * Native code keeps a pointer to the current cell in a register and
+ * updates the tape in place; as long as the pointer stays inside the
+ * range of cells described by the context, no call to the rest of the
+ * library is needed. Moving outside of that range, as well as any kind
+ * of input and output, goes through the callbacks stored in the
+ * context, after which the pointer and the range are reloaded.
+ *
+ * Code generation is only implemented for x86-64 on systems following
+ * the System V calling convention, and requires the ability to map
+ * executable memory. When either is missing, cattle_jit_compile()
+ * returns NULL and the caller is expected to use a different engine */
+
+#if defined (__x86_64__) && defined (__unix__)
+#define HAVE_JIT 1
+#endif
+
+#ifdef HAVE_JIT
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+
+typedef gint (*CattleJitFunction) (CattleJitContext *context);
+
+struct _CattleJitCode
+{
+    gpointer memory;
+    gsize    size;
+};
+
+/* Registers used by native code. All of them are callee-saved, so
+ * their contents survive calls to the callbacks:
+ *
+ *   rbx  current cell
+ *   r12  first cell in range
+ *   r13  last cell in range
+ *   r14  context
+ *   r15  scratch */
+
+#define OFFSET(field) ((guint8) G_STRUCT_OFFSET (CattleJitContext, field))
+
+/* Number of cells a trusted program can move, or add to, without any
+ * check. Cells are 8 bits wide, and the guard pages around the tape
+ * are at least this large, since pages are never smaller than 4 KiB
+ * on x86-64: a longer move could jump over a guard page entirely */
+#define GUARD_SIZE 4096
+
+static void
+emit (GByteArray  *code,
+      const gchar *bytes,
+      guint        len)
+{
+    g_byte_array_append (code, (const guint8 *) bytes, len);
+}
+
+static void
+emit_byte (GByteArray *code,
+           guint8      byte)
+{
+    g_byte_array_append (code, &byte, 1);
+}
+
+static void
+emit_u32 (GByteArray *code,
+          guint32     value)
+{
+    guint8 bytes[4];
+    guint  i;
+
+    for (i = 0; i < 4; i++)
+    {
+        bytes[i] = (value >> (i * 8)) & 0xff;
+    }
+
+    g_byte_array_append (code, bytes, 4);
+}
+
+static void
+emit_u64 (GByteArray *code,
+          guint64     value)
+{
+    emit_u32 (code, value & 0xffffffff);
+    emit_u32 (code, value >> 32);
+}
+
+/* Fill in the 32 bit displacement stored at @position so that it
+ * points to @target */
+static void
+patch (GByteArray *code,
+       guint       position,
+       guint       target)
+{
+    guint32 displacement;
+    guint   i;
+
+    displacement = (guint32) (target - (position + 4));
+
+    for (i = 0; i < 4; i++)
+    {
+        code->data[position + i] = (displacement >> (i * 8)) & 0xff;
+    }
+}
+
+/* Emit a jump with a 32 bit displacement, whose encoding is @opcode.
+ * Returns the position of the displacement, which will point to
+ * @target if it's already known or will have to be patched later */
+static guint
+emit_jump (GByteArray  *code,
+           const gchar *opcode,
+           guint        len,
+           guint        target)
+{
+    guint position;
+
+    emit (code, opcode, len);
+    position = code->len;
+    emit_u32 (code, 0);
+
+    if (target != G_MAXUINT)
+    {
+        patch (code, position, target);
+    }
+
+    return position;
+}
+
+/* Reload the current cell and range from the context */
+static void
+emit_load_context (GByteArray *code)
+{
+    emit (code, "\x49\x8b\x5e", 3); /* mov rbx, [r14 + current] */
+    emit_byte (code, OFFSET (current));
+    emit (code, "\x4d\x8b\x66", 3); /* mov r12, [r14 + first] */
+    emit_byte (code, OFFSET (first));
+    emit (code, "\x4d\x8b\x6e", 3); /* mov r13, [r14 + last] */
+    emit_byte (code, OFFSET (last));
+}
+
+/* Store the current cell in the context */
+static void
+emit_store_current (GByteArray *code)
+{
+    emit (code, "\x49\x89\x5e", 3); /* mov [r14 + current], rbx */
+    emit_byte (code, OFFSET (current));
+}
+
+/* Call one of the callbacks stored in the context. The return value
+ * is left in eax */
+static void
+emit_callback (GByteArray *code,
+               guint8      callback,
+               gulong      quantity)
+{
+    emit_store_current (code);
+    emit (code, "\x4c\x89\xf7", 3); /* mov rdi, r14 */
+    emit (code, "\x48\xbe", 2);     /* mov rsi, quantity */
+    emit_u64 (code, quantity);
+    emit (code, "\x41\xff\x56", 3); /* call [r14 + callback] */
+    emit_byte (code, callback);
+}
+
+/* Emit a move. Unless @trusted is %TRUE and @quantity is no larger
+ * than GUARD_SIZE, the code checks whether the target cell is in range
+ * and calls @callback otherwise, jumping to @failed if it returns
+ * FALSE */
+static void
+emit_move (GByteArray *code,
+           guint8      callback,
+           gulong      quantity,
+           gboolean    left,
+           guint       failed,
+           gboolean    trusted)
+{
+    guint below;
+    guint above;
+    guint done;
+
+    /* Short moves in trusted programs are not checked at all */
+    if (quantity <= GUARD_SIZE && trusted)
+    {
+        /* lea rbx, [rbx + displacement] */
+        emit (code, "\x48\x8d\x9b", 3);
+        emit_u32 (code, left ? (guint32) -(gint32) quantity : (guint32) quantity);
+
+        return;
+    }
+
+    /* Moves that are too long to be encoded directly always take
+     * the slow path */
+    if (quantity <= G_MAXINT32)
+    {
+        /* lea rax, [rbx + displacement] */
+        emit (code, "\x48\x8d\x83", 3);
+        emit_u32 (code, left ? (guint32) -(gint32) quantity : (guint32) quantity);
+
+        emit (code, "\x4c\x39\xe0", 3);                     /* cmp rax, r12 */
+        below = emit_jump (code, "\x0f\x82", 2, G_MAXUINT); /* jb slow path */
+        emit (code, "\x4c\x39\xe8", 3);                     /* cmp rax, r13 */
+        above = emit_jump (code, "\x0f\x87", 2, G_MAXUINT); /* ja slow path */
+        emit (code, "\x48\x89\xc3", 3);                     /* mov rbx, rax */
+        done = emit_jump (code, "\xe9", 1, G_MAXUINT);       /* jmp done */
+
+        patch (code, below, code->len);
+        patch (code, above, code->len);
+    }
+    else
+    {
+        done = G_MAXUINT;
+    }
+
+    /* Slow path */
+    emit_callback (code, callback, quantity);
+    emit (code, "\x85\xc0", 2);     /* test eax, eax */
+    emit_jump (code, "\x0f\x84", 2, failed);
+    emit_load_context (code);
+
+    if (done != G_MAXUINT)
+    {
+        patch (code, done, code->len);
+    }
+}
+
+/* Add either @quantity or, if @scratch is %TRUE, the value of r15b to
+ * the cell @offset cells away from the one pointed to by @base, which
+ * is one of the ModRM encodings below. @offset must fit in 32 bits */
+#define BASE_RAX 0x00
+#define BASE_RBX 0x03
+
+static void
+emit_add (GByteArray *code,
+          guint8      base,
+          glong       offset,
+          gboolean    scratch,
+          guint8      quantity)
+{
+    guint8 modrm;
+
+    /* Use a 32 bit displacement if needed */
+    modrm = (offset != 0) ? (0x80 | base) : base;
+
+    if (scratch)
+    {
+        emit (code, "\x44\x00", 2);    /* add byte [base + offset], r15b */
+        emit_byte (code, 0x38 | modrm);
+    }
+    else
+    {
+        emit_byte (code, 0x80);         /* add byte [base + offset], quantity */
+        emit_byte (code, modrm);
+    }
+
+    if (offset != 0)
+    {
+        emit_u32 (code, (guint32) (gint32) offset);
+    }
+
+    if (!scratch)
+    {
+        emit_byte (code, quantity);
+    }
+}
+
+/* Add to the cell @offset cells away from the current one. The cell
+ * is addressed directly if it's in range, or if @trusted is %TRUE and
+ * it's no further than GUARD_SIZE cells away; otherwise, the tape is
+ * moved there and back so that it can grow.
+ * @offset must fit in 32 bits */
+static void
+emit_add_at_offset (GByteArray *code,
+                    glong       offset,
+                    gboolean    scratch,
+                    guint8      quantity,
+                    guint       failed,
+                    gboolean    trusted)
+{
+    guint below;
+    guint above;
+    guint done;
+
+    if (offset == 0 || (trusted && ABS (offset) <= GUARD_SIZE))
+    {
+        emit_add (code, BASE_RBX, offset, scratch, quantity);
+
+        return;
+    }
+
+    /* lea rax, [rbx + offset] */
+    emit (code, "\x48\x8d\x83", 3);
+    emit_u32 (code, (guint32) (gint32) offset);
+
+    emit (code, "\x4c\x39\xe0", 3);                     /* cmp rax, r12 */
+    below = emit_jump (code, "\x0f\x82", 2, G_MAXUINT); /* jb slow path */
+    emit (code, "\x4c\x39\xe8", 3);                     /* cmp rax, r13 */
+    above = emit_jump (code, "\x0f\x87", 2, G_MAXUINT); /* ja slow path */
+    emit_add (code, BASE_RAX, 0, scratch, quantity);
+    done = emit_jump (code, "\xe9", 1, G_MAXUINT);       /* jmp done */
+
+    /* Slow path */
+    patch (code, below, code->len);
+    patch (code, above, code->len);
+
+    emit_move (code,
+               offset < 0 ? OFFSET (move_left) : OFFSET (move_right),
+               ABS (offset),
+               offset < 0,
+               failed,
+               FALSE);
+    emit_add (code, BASE_RBX, 0, scratch, quantity);
+    emit_move (code,
+               offset < 0 ? OFFSET (move_right) : OFFSET (move_left),
+               ABS (offset),
+               offset >= 0,
+               failed,
+               FALSE);
+
+    patch (code, done, code->len);
+}
+
+static void
+generate (CattleBytecode *bytecode,
+          GByteArray     *code,
+          gboolean        trusted)
+{
+    CattleOp *op;
+    guint    *offsets;
+    guint    *fixups;
+    guint     epilogue;
+    guint     failed;
+    guint     unbalanced;
+    guint     body;
+    guint     done;
+    gulong    i;
+
+    offsets = g_new0 (guint, bytecode->n_ops);
+    fixups = g_new0 (guint, bytecode->n_ops);
+
+    /* Prologue. Five registers are pushed so that the stack is
+     * aligned to 16 bytes when calling callbacks */
+    emit (code, "\x53", 1);         /* push rbx */
+    emit (code, "\x41\x54", 2);     /* push r12 */
+    emit (code, "\x41\x55", 2);     /* push r13 */
+    emit (code, "\x41\x56", 2);     /* push r14 */
+    emit (code, "\x41\x57", 2);     /* push r15 */
+    emit (code, "\x49\x89\xfe", 3); /* mov r14, rdi */
+    emit_load_context (code);
+    body = emit_jump (code, "\xe9", 1, G_MAXUINT);
+
+    /* Exit paths, placed before the body so that jumps to them can
+     * be emitted right away */
+    epilogue = code->len;
+    emit_store_current (code);
+    emit (code, "\x41\x5f", 2); /* pop r15 */
+    emit (code, "\x41\x5e", 2); /* pop r14 */
+    emit (code, "\x41\x5d", 2); /* pop r13 */
+    emit (code, "\x41\x5c", 2); /* pop r12 */
+    emit (code, "\x5b", 1);     /* pop rbx */
+    emit (code, "\xc3", 1);     /* ret */
+
+    failed = code->len;
+    emit_byte (code, 0xb8);     /* mov eax, CATTLE_JIT_STATUS_FAILED */
+    emit_u32 (code, CATTLE_JIT_STATUS_FAILED);
+    emit_jump (code, "\xe9", 1, epilogue);
+
+    unbalanced = code->len;
+    emit_byte (code, 0xb8);     /* mov eax, CATTLE_JIT_STATUS_UNBALANCED */
+    emit_u32 (code, CATTLE_JIT_STATUS_UNBALANCED);
+    emit_jump (code, "\xe9", 1, epilogue);
+
+    patch (code, body, code->len);
+
+    for (i = 0; i < bytecode->n_ops; i++)
+    {
+        op = &(bytecode->ops[i]);
+        offsets[i] = code->len;
+
+        switch (op->opcode)
+        {
+            case CATTLE_OP_LOOP_BEGIN:
+
+                /* Skip the loop if the current value is zero */
+                emit (code, "\x80\x3b\x00", 3); /* cmp byte [rbx], 0 */
+                fixups[i] = emit_jump (code, "\x0f\x84", 2, G_MAXUINT);
+
+                break;
+
+            case CATTLE_OP_LOOP_END:
+
+                /* Repeat the loop if the current value is not zero */
+                emit (code, "\x80\x3b\x00", 3); /* cmp byte [rbx], 0 */
+                fixups[i] = emit_jump (code, "\x0f\x85", 2, G_MAXUINT);
+
+                break;
+
+            case CATTLE_OP_MOVE_LEFT:
+
+                emit_move (code,
+                           OFFSET (move_left),
+                           op->quantity,
+                           TRUE,
+                           failed,
+                           trusted);
+
+                break;
+
+            case CATTLE_OP_MOVE_RIGHT:
+
+                emit_move (code,
+                           OFFSET (move_right),
+                           op->quantity,
+                           FALSE,
+                           failed,
+                           trusted);
+
+                break;
+
+            case CATTLE_OP_INCREASE:
+
+                emit_add_at_offset (code,
+                                    op->offset,
+                                    FALSE,
+                                    op->quantity & 0xff,
+                                    failed,
+                                    trusted);
+
+                break;
+
+            case CATTLE_OP_SET_ZERO:
+
+                emit (code, "\xc6\x03\x00", 3); /* mov byte [rbx], 0 */
+
+                break;
+
+            case CATTLE_OP_MULTIPLY:
+
+                /* Compute the amount to be added, then add it to the
+                 * target cell. r15 is used so that the value survives
+                 * calls to callbacks */
+                emit (code, "\x0f\xb6\x03", 3); /* movzx eax, byte [rbx] */
+                emit (code, "\x69\xc0", 2);     /* imul eax, eax, quantity */
+                emit_u32 (code, op->quantity & 0xff);
+                emit (code, "\x41\x89\xc7", 3); /* mov r15d, eax */
+
+                emit_add_at_offset (code,
+                                    op->offset,
+                                    TRUE,
+                                    0,
+                                    failed,
+                                    trusted);
+
+                break;
+
+            case CATTLE_OP_SCAN_LEFT:
+            case CATTLE_OP_SCAN_RIGHT:
+
+                /* Scans often stop right away, so the search is only
+                 * performed if the current value is not zero */
+                emit (code, "\x80\x3b\x00", 3); /* cmp byte [rbx], 0 */
+                done = emit_jump (code, "\x0f\x84", 2, G_MAXUINT);
+
+                emit_callback (code,
+                               op->opcode == CATTLE_OP_SCAN_LEFT ? OFFSET (scan_left)
+                                                                 : OFFSET (scan_right),
+                               op->quantity);
+                emit (code, "\x85\xc0", 2);     /* test eax, eax */
+                emit_jump (code, "\x0f\x84", 2, failed);
+                emit_load_context (code);
+
+                patch (code, done, code->len);
+
+                break;
+
+            case CATTLE_OP_READ:
+            case CATTLE_OP_PRINT:
+            case CATTLE_OP_DEBUG:
+
+                if (op->opcode == CATTLE_OP_READ)
+                {
+                    emit_callback (code, OFFSET (read), op->quantity);
+                }
+                else if (op->opcode == CATTLE_OP_PRINT)
+                {
+                    emit_callback (code, OFFSET (print), op->quantity);
+                }
+                else
+                {
+                    emit_callback (code, OFFSET (debug), op->quantity);
+                }
+
+                emit (code, "\x85\xc0", 2);     /* test eax, eax */
+                emit_jump (code, "\x0f\x84", 2, failed);
+
+                /* Handlers are allowed to move the tape */
+                emit_load_context (code);
+
+                break;
+
+            case CATTLE_OP_UNBALANCED:
+
+                emit_jump (code, "\xe9", 1, unbalanced);
+
+                break;
+
+            case CATTLE_OP_END:
+
+                emit (code, "\x31\xc0", 2);     /* xor eax, eax */
+                emit_jump (code, "\xe9", 1, epilogue);
+
+                break;
+        }
+    }
+
+    /* Link loops now that the position of all operations is known.
+     * Just like the interpreter, jumps land right after the matching
+     * operation */
+    for (i = 0; i < bytecode->n_ops; i++)
+    {
+        op = &(bytecode->ops[i]);
+
+        if (op->opcode == CATTLE_OP_LOOP_BEGIN ||
+            op->opcode == CATTLE_OP_LOOP_END)
+        {
+            patch (code, fixups[i], offsets[op->jump + 1]);
+        }
+    }
+
+    g_free (offsets);
+    g_free (fixups);
+}
+
+/* Compile @bytecode to native code. If @trusted is %TRUE, the program
+ * is trusted never to move the tape outside of the range passed in the
+ * context, which must be surrounded by guard pages, so no checks are
+ * performed for moves too short to jump over them. Returns NULL if
+ * native code can't be generated */
+CattleJitCode*
+cattle_jit_compile (CattleBytecode *bytecode,
+                    gboolean        trusted)
+{
+    CattleJitCode *jit;
+    GByteArray    *code;
+    gpointer       memory;
+    gsize          page_size;
+    gsize          size;
+
+    g_return_val_if_fail (bytecode != NULL, NULL);
+
+    code = g_byte_array_new ();
+    generate (bytecode, code, trusted);
+
+    page_size = sysconf (_SC_PAGESIZE);
+    size = ((code->len + page_size - 1) / page_size) * page_size;
+
+    /* Map the memory as writable first, then make it executable once
+     * the code is in place, so that it's never both at the same time */
+    memory = mmap (NULL,
+                   size,
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1,
+                   0);
+
+    if (memory == MAP_FAILED)
+    {
+        g_byte_array_free (code, TRUE);
+
+        return NULL;
+    }
+
+    memcpy (memory, code->data, code->len);
+    g_byte_array_free (code, TRUE);
+
+    if (mprotect (memory, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap (memory, size);
+
+        return NULL;
+    }
+
+    jit = g_new0 (CattleJitCode, 1);
+    jit->memory = memory;
+    jit->size = size;
+
+    return jit;
+}
+
+/* Run native code. @context must have been filled in by the caller */
+CattleJitStatus
+cattle_jit_run (CattleJitCode    *jit,
+                CattleJitContext *context)
+{
+    CattleJitFunction function;
+
+    g_return_val_if_fail (jit != NULL, CATTLE_JIT_STATUS_FAILED);
+    g_return_val_if_fail (context != NULL, CATTLE_JIT_STATUS_FAILED);
+
+    function = (CattleJitFunction) jit->memory;
+
+    return (*function) (context);
+}
+
+void
+cattle_jit_free (CattleJitCode *jit)
+{
+    g_return_if_fail (jit != NULL);
+
+    munmap (jit->memory, jit->size);
+    g_free (jit);
+}
+
+#else /* !HAVE_JIT */
+
+CattleJitCode*
+cattle_jit_compile (CattleBytecode *bytecode G_GNUC_UNUSED,
+                    gboolean        trusted G_GNUC_UNUSED)
+{
+    return NULL;
+}
+
+CattleJitStatus
+cattle_jit_run (CattleJitCode    *jit G_GNUC_UNUSED,
+                CattleJitContext *context G_GNUC_UNUSED)
+{
+    g_return_val_if_reached (CATTLE_JIT_STATUS_FAILED);
+}
+
+void
+cattle_jit_free (CattleJitCode *jit G_GNUC_UNUSED)
+{
+    g_return_if_reached ();
+}
+
+#endif /* HAVE_JIT */
@@ -0,0 +1,57 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#if !defined (CATTLE_COMPILATION)
+#error "This header is private to Cattle and can't be included directly."
+#endif
+
+#ifndef __CATTLE_NODE_PRIVATE_H__
+#define __CATTLE_NODE_PRIVATE_H__
+
+#include <glib.h>
+#include "cattle-instruction.h"
+
+G_BEGIN_DECLS
+
+/* Marks the end of a loop that was never closed, or the end of a loop
+ * that was never opened, in instructions that have been built by hand */
+#define CATTLE_NODE_UNBALANCED 0
+
+/* Longer runs are split across several nodes */
+#define CATTLE_NODE_MAX_QUANTITY G_MAXUINT32
+
+typedef struct _CattleNode CattleNode;
+
+struct _CattleNode
+{
+    gulong  jump;     /* Index of the matching loop node */
+    guint32 quantity;
+    guint8  value;    /* A CattleInstructionValue, or
+                       * CATTLE_NODE_UNBALANCED */
+};
+
+void               cattle_node_append  (GArray                 *nodes,
+                                        CattleInstructionValue  value,
+                                        gulong                  quantity);
+GArray*            cattle_node_flatten (CattleInstruction      *instructions);
+CattleInstruction* cattle_node_expand  (GArray                 *nodes);
+
+G_END_DECLS
+
+#endif /* __CATTLE_NODE_PRIVATE_H__ */
@@ -0,0 +1,336 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+
+#include "cattle-node-private.h"
+
+/* Nodes are a compact representation of a tree of instructions, used
+ * internally so that loading a program doesn't require creating one
+ * #CattleInstruction object for each instruction.
+ *
+ * All nodes are stored in a single array, in the order they appear in
+ * the source code: the body of a loop immediately follows the node
+ * that starts it, and ends with the node that closes it. The two point
+ * at each other, so the instruction following a loop can be found
+ * right away.
+ *
+ * No-op instructions are not stored at all, and empty programs are
+ * represented by an empty array. */
+
+typedef struct _CattleNodeFrame CattleNodeFrame;
+
+struct _CattleNodeFrame
+{
+    gulong             begin; /* Index of the loop node */
+    CattleInstruction *next;  /* Instruction to resume from */
+};
+
+typedef struct _CattleNodeLevel CattleNodeLevel;
+
+struct _CattleNodeLevel
+{
+    CattleInstruction *first;    /* First instruction of the level */
+    CattleInstruction *previous; /* Last instruction of the level */
+};
+
+/* Append nodes for @quantity instructions of type @value. Quantities
+ * that don't fit in a single node are split */
+void
+cattle_node_append (GArray                 *nodes,
+                    CattleInstructionValue  value,
+                    gulong                  quantity)
+{
+    CattleNode node;
+
+    node.jump = 0;
+    node.value = value;
+
+    while (quantity > CATTLE_NODE_MAX_QUANTITY)
+    {
+        node.quantity = CATTLE_NODE_MAX_QUANTITY;
+        g_array_append_val (nodes, node);
+
+        quantity -= CATTLE_NODE_MAX_QUANTITY;
+    }
+
+    node.quantity = quantity;
+    g_array_append_val (nodes, node);
+}
+
+/* Close the loop starting at @begin with a node of type @value, and
+ * link the two together */
+static void
+close_loop (GArray                 *nodes,
+            gulong                  begin,
+            CattleInstructionValue  value)
+{
+    cattle_node_append (nodes, value, 1);
+
+    g_array_index (nodes, CattleNode, nodes->len - 1).jump = begin;
+    g_array_index (nodes, CattleNode, begin).jump = nodes->len - 1;
+}
+
+/* Convert a tree of instructions to nodes.
+ *
+ * Instructions built by hand might have unbalanced brackets: a loop
+ * whose instructions run out before it's closed is terminated by a
+ * CATTLE_NODE_UNBALANCED node, and so is the top level if a loop is
+ * closed there. Instructions that can never be reached, such as the
+ * ones following the end of a loop, are not converted */
+GArray*
+cattle_node_flatten (CattleInstruction *instructions)
+{
+    CattleNodeFrame        *frame;
+    CattleInstruction      *current;
+    CattleInstruction      *next;
+    CattleInstructionValue  value;
+    GArray                 *nodes;
+    GSList                 *stack;
+
+    g_return_val_if_fail (CATTLE_IS_INSTRUCTION (instructions), NULL);
+
+    nodes = g_array_new (FALSE, FALSE, sizeof (CattleNode));
+    stack = NULL;
+
+    current = instructions;
+    g_object_ref (current);
+
+    while (TRUE)
+    {
+        if (current == NULL)
+        {
+            /* Out of instructions at the top level: we're done */
+            if (stack == NULL)
+            {
+                break;
+            }
+
+            /* Out of instructions inside a loop */
+            frame = stack->data;
+            stack = g_slist_delete_link (stack, stack);
+
+            close_loop (nodes, frame->begin, CATTLE_NODE_UNBALANCED);
+
+            current = frame->next;
+            g_free (frame);
+
+            continue;
+        }
+
+        value = cattle_instruction_get_value (current);
+
+        switch (value)
+        {
+            case CATTLE_INSTRUCTION_LOOP_BEGIN:
+
+                /* Remember where to resume after the loop, then
+                 * convert the instructions inside it */
+                frame = g_new0 (CattleNodeFrame, 1);
+                frame->begin = nodes->len;
+                frame->next = cattle_instruction_get_next (current);
+
+                cattle_node_append (nodes, value, 1);
+
+                stack = g_slist_prepend (stack, frame);
+                next = cattle_instruction_get_loop (current);
+
+                break;
+
+            case CATTLE_INSTRUCTION_LOOP_END:
+
+                if (stack == NULL)
+                {
+                    /* Not inside a loop: nothing past this point can
+                     * ever be reached */
+                    cattle_node_append (nodes, CATTLE_NODE_UNBALANCED, 1);
+                    next = NULL;
+
+                    break;
+                }
+
+                frame = stack->data;
+                stack = g_slist_delete_link (stack, stack);
+
+                close_loop (nodes, frame->begin, value);
+
+                next = frame->next;
+                g_free (frame);
+
+                break;
+
+            case CATTLE_INSTRUCTION_MOVE_LEFT:
+            case CATTLE_INSTRUCTION_MOVE_RIGHT:
+            case CATTLE_INSTRUCTION_INCREASE:
+            case CATTLE_INSTRUCTION_DECREASE:
+            case CATTLE_INSTRUCTION_READ:
+            case CATTLE_INSTRUCTION_PRINT:
+            case CATTLE_INSTRUCTION_DEBUG:
+
+                cattle_node_append (nodes,
+                                    value,
+                                    cattle_instruction_get_quantity (current));
+                next = cattle_instruction_get_next (current);
+
+                break;
+
+            case CATTLE_INSTRUCTION_NONE:
+            default:
+
+                /* Nothing to execute */
+                next = cattle_instruction_get_next (current);
+
+                break;
+        }
+
+        g_object_unref (current);
+        current = next;
+    }
+
+    return nodes;
+}
+
+/* Create a new instruction and link it after the last instruction
+ * in @level */
+static void
+append_instruction (CattleNodeLevel        *level,
+                    CattleInstructionValue  value,
+                    gulong                  quantity,
+                    CattleInstruction      *loop)
+{
+    CattleInstruction *current;
+
+    current = cattle_instruction_new ();
+
+    cattle_instruction_set_value (current, value);
+    cattle_instruction_set_quantity (current, quantity);
+
+    if (loop != NULL)
+    {
+        cattle_instruction_set_loop (current, loop);
+    }
+
+    if (level->first == NULL)
+    {
+        /* Acquire an extra reference to the first instruction to
+         * make sure the whole level is kept alive */
+        level->first = current;
+        g_object_ref (level->first);
+    }
+
+    if (level->previous != NULL)
+    {
+        /* Link the current instruction to the previous one */
+        cattle_instruction_set_next (level->previous, current);
+    }
+
+    level->previous = current;
+    g_object_unref (current);
+}
+
+/* Convert nodes back to a tree of instructions. Nested loops are
+ * handled using an explicit stack, so the nesting level is only
+ * limited by the amount of available memory */
+CattleInstruction*
+cattle_node_expand (GArray *nodes)
+{
+    CattleNodeLevel    level;
+    CattleInstruction *loop;
+    CattleNode        *node;
+    GArray            *stack;
+    gulong             i;
+
+    g_return_val_if_fail (nodes != NULL, NULL);
+
+    level.first = NULL;
+    level.previous = NULL;
+
+    stack = g_array_new (FALSE, FALSE, sizeof (CattleNodeLevel));
+
+    for (i = 0; i < nodes->len; i++)
+    {
+        node = &g_array_index (nodes, CattleNode, i);
+
+        switch (node->value)
+        {
+            case CATTLE_INSTRUCTION_LOOP_BEGIN:
+
+                /* Save the current level and start with the loop */
+                g_array_append_val (stack, level);
+
+                level.first = NULL;
+                level.previous = NULL;
+
+                break;
+
+            case CATTLE_INSTRUCTION_LOOP_END:
+            case CATTLE_NODE_UNBALANCED:
+
+                /* The end of a loop that was never opened */
+                if (stack->len == 0)
+                {
+                    append_instruction (&level,
+                                        CATTLE_INSTRUCTION_LOOP_END,
+                                        1,
+                                        NULL);
+                    break;
+                }
+
+                /* Loops that were never closed don't end with a
+                 * CATTLE_INSTRUCTION_LOOP_END instruction */
+                if (node->value == CATTLE_INSTRUCTION_LOOP_END)
+                {
+                    append_instruction (&level, node->value, 1, NULL);
+                }
+
+                /* Go back to the outer level and link the loop */
+                loop = level.first;
+
+                level = g_array_index (stack, CattleNodeLevel, stack->len - 1);
+                g_array_set_size (stack, stack->len - 1);
+
+                append_instruction (&level,
+                                    CATTLE_INSTRUCTION_LOOP_BEGIN,
+                                    1,
+                                    loop);
+
+                if (loop != NULL)
+                {
+                    g_object_unref (loop);
+                }
+
+                break;
+
+            default:
+
+                append_instruction (&level, node->value, node->quantity, NULL);
+
+                break;
+        }
+    }
+
+    g_array_free (stack, TRUE);
+
+    if (level.first == NULL)
+    {
+        /* Empty program. Create a no-op */
+        level.first = cattle_instruction_new ();
+    }
+
+    return level.first;
+}
@@ -0,0 +1,37 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#if !defined (CATTLE_COMPILATION)
+#error "This header is private to Cattle and can't be included directly."
+#endif
+
+#ifndef __CATTLE_PROGRAM_PRIVATE_H__
+#define __CATTLE_PROGRAM_PRIVATE_H__
+
+#include <glib.h>
+#include "cattle-bytecode-private.h"
+#include "cattle-program.h"
+
+G_BEGIN_DECLS
+
+CattleBytecode* cattle_program_get_bytecode (CattleProgram *program);
+
+G_END_DECLS
+
+#endif /* __CATTLE_PROGRAM_PRIVATE_H__ */
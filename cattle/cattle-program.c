@@ -19,7 +19,10 @@
 
 #include "cattle-enums.h"
 #include "cattle-error.h"
+#include "cattle-constants.h"
 #include "cattle-program.h"
+#include "cattle-program-private.h"
+#include <stdarg.h>
 
 /**
  * SECTION:cattle-program
@@ -55,8 +58,16 @@ struct _CattleProgramPrivate
 {
     gboolean           disposed;
 
-    CattleInstruction *instructions;
+    CattleInstruction *instructions; /* Instructions, or NULL if they
+                                      * have not been created from
+                                      * the nodes yet */
+    GArray            *nodes;        /* Compact form of the
+                                      * instructions, or NULL if not
+                                      * created yet */
     CattleBuffer      *input;
+
+    CattleBytecode    *bytecode;     /* Compiled instructions, or NULL
+                                      * if not compiled yet */
 };
 
 G_DEFINE_TYPE_WITH_CODE (CattleProgram, cattle_program, G_TYPE_OBJECT,
@@ -71,10 +82,13 @@ enum
 };
 
 /* Internal functions */
-static gulong load (CattleBuffer       *buffer,
-                    gulong              offset,
-                    CattleInstruction **instructions,
-                    CattleBuffer      **input);
+static gboolean load      (CattleBuffer   *buffer,
+                           GArray        **nodes,
+                           CattleBuffer  **input,
+                           GError        **error);
+static void     set_nodes (CattleProgram  *program,
+                           GArray         *nodes);
+static GArray*  get_nodes (CattleProgram  *program);
 
 /* Symbols used by the code loader */
 #define BANG_SYMBOL    0x21 /*  !  */
@@ -88,7 +102,9 @@ cattle_program_init (CattleProgram *self)
     priv = cattle_program_get_instance_private (self);
 
     priv->instructions = cattle_instruction_new ();
+    priv->nodes = NULL;
     priv->input = cattle_buffer_new (0);
+    priv->bytecode = NULL;
 
     priv->disposed = FALSE;
 
@@ -106,7 +122,7 @@ cattle_program_dispose (GObject *object)
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    g_object_unref (priv->instructions);
+    set_nodes (self, NULL);
     g_object_unref (priv->input);
 
     priv->disposed = TRUE;
@@ -120,36 +136,71 @@ cattle_program_finalize (GObject *object)
     G_OBJECT_CLASS (cattle_program_parent_class)->finalize (object);
 }
 
-static gulong
-load (CattleBuffer       *buffer,
-      gulong              offset,
-      CattleInstruction **instructions,
-      CattleBuffer      **input)
+/* Get the instruction that undoes the effect of @value, if any.
+ *
+ * Moves are never undone this way: even when they end up where they
+ * started, the cells they pass over count as reached, and doing so can
+ * grow the tape, leave a fixed one or change what a debug dump shows */
+static CattleInstructionValue
+get_opposite (CattleInstructionValue value)
+{
+    switch (value)
+    {
+        case CATTLE_INSTRUCTION_INCREASE:
+
+            return CATTLE_INSTRUCTION_DECREASE;
+
+        case CATTLE_INSTRUCTION_DECREASE:
+
+            return CATTLE_INSTRUCTION_INCREASE;
+
+        default:
+
+            return CATTLE_INSTRUCTION_NONE;
+    }
+}
+
+/* Parse the code contained in @buffer and the input following it, if
+ * any. The code is stored as nodes, so no #CattleInstruction has to be
+ * created until someone asks for them.
+ *
+ * Nested loops are handled using an explicit stack rather than
+ * recursion, so the nesting level is only limited by the amount of
+ * available memory. Brackets are checked along the way: if they are
+ * not balanced, nothing is returned and @error is set */
+static gboolean
+load (CattleBuffer  *buffer,
+      GArray       **nodes,
+      CattleBuffer **input,
+      GError       **error)
 {
-    CattleInstruction *first;
-    CattleInstruction *current;
-    CattleInstruction *previous;
-    CattleInstruction *loop;
-    gint8              value;
-    gint8              temp;
-    gulong             quantity;
-    gulong             size;
-    gulong             i;
-    gulong             c;
-
-    first = NULL;
-    previous = NULL;
-
-    i = offset;
+    CattleInstructionValue  value;
+    CattleInstructionValue  pending;
+    GArray                 *code;
+    GArray                 *stack;
+    const gint8            *data;
+    gulong                  begin;
+    gulong                  end;
+    gulong                  quantity;
+    gulong                  size;
+    gulong                  i;
+
+    code = g_array_new (FALSE, FALSE, sizeof (CattleNode));
+    stack = g_array_new (FALSE, FALSE, sizeof (gulong));
+
+    /* Nodes are not created right away: consecutive symbols are
+     * collected in a run, which is only turned into a node once a
+     * different symbol is found */
+    pending = CATTLE_INSTRUCTION_NONE;
+    quantity = 0;
+
+    data = cattle_buffer_peek_contents (buffer);
     size = cattle_buffer_get_size (buffer);
 
-    while (i < size)
+    for (i = 0; i < size; i++)
     {
-        current = NULL;
-
         /* Read a value from the input buffer */
-        value = cattle_buffer_get_value (buffer, i);
-        quantity = 1;
+        value = data[i];
 
         /* Start of program's input, stop parsing */
         if (value == BANG_SYMBOL)
@@ -180,115 +231,180 @@ load (CattleBuffer       *buffer,
                 break;
         }
 
-        /* Not an instruction, move on */
+        /* Not an instruction, move on. This doesn't interrupt the
+         * current run, so comments and whitespace can appear in
+         * the middle of it */
         if (value == CATTLE_INSTRUCTION_NONE)
         {
-            i++;
             continue;
-        } 
+        }
 
-        /* Read a sequence of identical symbols, counting them.
+        /* Same symbol as the current run: increase the quantity.
          * Loops can't be optimized this way */
-        if (value != CATTLE_INSTRUCTION_LOOP_BEGIN &&
+        if (value == pending &&
+            value != CATTLE_INSTRUCTION_LOOP_BEGIN &&
             value != CATTLE_INSTRUCTION_LOOP_END)
         {
-            while (i + 1 < size)
-            {
-                temp = cattle_buffer_get_value (buffer, i + 1);
+            quantity++;
+            continue;
+        }
 
-                if (temp == value)
-                {
-                    /* Same value: increase the quantity */
-                    quantity++;
-                    i++;
-                }
-                else
-                {
-                    break;
-                }
+        /* Opposite symbol: the two cancel each other out. If the
+         * run is emptied this way, a new one can start */
+        if (pending != CATTLE_INSTRUCTION_NONE &&
+            value == get_opposite (pending))
+        {
+            quantity--;
+            if (quantity == 0)
+            {
+                pending = CATTLE_INSTRUCTION_NONE;
             }
+            continue;
         }
 
-        /* Create a new instruction */
-        current = cattle_instruction_new ();
-
-        cattle_instruction_set_value (current, value);
-        cattle_instruction_set_quantity (current, quantity);
-
-        if (value == CATTLE_INSTRUCTION_LOOP_BEGIN)
+        /* Different symbol: the current run is over */
+        if (pending != CATTLE_INSTRUCTION_NONE)
         {
-            /* Parse the loop */
-            i = load (buffer,
-                      i + 1,
-                      &loop,
-                      NULL);
-            i--;
-
-            cattle_instruction_set_loop (current, loop);
-            g_object_unref (loop);
+            cattle_node_append (code, pending, quantity);
+            pending = CATTLE_INSTRUCTION_NONE;
         }
 
-        if (first == NULL)
+        if (value == CATTLE_INSTRUCTION_LOOP_BEGIN)
         {
-            first = current;
+            /* Remember where the loop starts */
+            begin = code->len;
+            g_array_append_val (stack, begin);
+
+            cattle_node_append (code, value, 1);
 
-            /* Acquire an extra reference to the first
-             * instruction to make sure the whole loop
-             * is kept alive */
-            g_object_ref (first);
+            continue;
         }
 
-        if (previous != NULL)
+        if (value == CATTLE_INSTRUCTION_LOOP_END)
         {
-            /* Link the current instruction to the previous one */
-            cattle_instruction_set_next (previous, current);
-        }
+            /* Closing a loop that was never opened */
+            if (stack->len == 0)
+            {
+                break;
+            }
 
-        previous = current;
-        g_object_unref (current);
+            begin = g_array_index (stack, gulong, stack->len - 1);
+            g_array_set_size (stack, stack->len - 1);
 
-        /* Move to the next byte */
-        i++;
+            /* Link the two ends of the loop together */
+            end = code->len;
+            cattle_node_append (code, value, 1);
 
-        /* Exit on loop end */
-        if (value == CATTLE_INSTRUCTION_LOOP_END)
-        {
-            break;
+            g_array_index (code, CattleNode, begin).jump = end;
+            g_array_index (code, CattleNode, end).jump = begin;
+
+            continue;
         }
+
+        /* Start a new run */
+        pending = value;
+        quantity = 1;
     }
 
-    if (first == NULL)
+    /* Report an error if a loop was closed without being opened, or
+     * if not all loops have been closed */
+    if ((i < size && value == CATTLE_INSTRUCTION_LOOP_END) || stack->len > 0)
     {
-        /* Empty branch. Create a no-op */
-        first = cattle_instruction_new ();
+        g_set_error (error,
+                     CATTLE_ERROR,
+                     CATTLE_ERROR_UNBALANCED_BRACKETS,
+                     "Unbalanced brackets");
+
+        g_array_free (stack, TRUE);
+        g_array_free (code, TRUE);
+
+        return FALSE;
     }
 
-    *instructions = first;
+    g_array_free (stack, TRUE);
 
-    /* Collect any input */
-    if (input != NULL)
+    /* Out of code: the last run is over */
+    if (pending != CATTLE_INSTRUCTION_NONE)
     {
-        if (i < size)
-        {
-            *input = cattle_buffer_new (size - i);
+        cattle_node_append (code, pending, quantity);
+    }
 
-            c = 0;
-            while (i < size)
-            {
-                value = cattle_buffer_get_value (buffer, i);
-                cattle_buffer_set_value (*input, c, value);
+    *nodes = code;
 
-                c++;
-                i++;
-            }
-        }
-        else
+    /* Collect any input. It's not copied, but shared with @buffer,
+     * so loading a program takes the same time regardless of how much
+     * input it contains */
+    if (i < size)
+    {
+        *input = cattle_buffer_new_slice (buffer, i, size - i);
+    }
+    else
+    {
+        *input = cattle_buffer_new (0);
+    }
+
+    return TRUE;
+}
+
+/* Replace the instructions for @program with @nodes, which might be
+ * %NULL. Any existing instructions and compiled code are released */
+static void
+set_nodes (CattleProgram *self,
+           GArray        *nodes)
+{
+    CattleProgramPrivate *priv;
+
+    priv = self->priv;
+
+    if (priv->instructions != NULL)
+    {
+        g_object_unref (priv->instructions);
+        priv->instructions = NULL;
+    }
+
+    if (priv->nodes != NULL)
+    {
+        g_array_free (priv->nodes, TRUE);
+    }
+
+    priv->nodes = nodes;
+
+    /* The compiled instructions are now stale */
+    if (priv->bytecode != NULL)
+    {
+        cattle_bytecode_unref (priv->bytecode);
+        priv->bytecode = NULL;
+    }
+}
+
+/* Get the nodes for @program, creating them from the instructions
+ * if needed */
+static GArray*
+get_nodes (CattleProgram *self)
+{
+    CattleProgramPrivate *priv;
+    GArray               *nodes;
+
+    priv = self->priv;
+
+    nodes = g_atomic_pointer_get (&priv->nodes);
+
+    if (nodes == NULL)
+    {
+        nodes = cattle_node_flatten (priv->instructions);
+
+        /* Interpreters in other threads might be running the same
+         * program: if one of them got here first, use its nodes */
+        if (!g_atomic_pointer_compare_and_exchange (&priv->nodes,
+                                                    NULL,
+                                                    nodes))
         {
-            *input = cattle_buffer_new (0);
+            g_array_free (nodes, TRUE);
+            nodes = g_atomic_pointer_get (&priv->nodes);
         }
     }
 
-    return i;
+    return nodes;
 }
 
 /**
@@ -318,7 +434,8 @@ cattle_program_new (void)
  *
  * The buffer can optionally contain also the input for the program:
  * in that case, the input must be separated from the code by a bang
- * (!) character.
+ * (!) character. The input is not copied, but shared with @buffer, so
+ * the contents of @buffer should not be changed afterwards.
  *
  * In case of failure, @error is filled with detailed information.
  * The error domain is %CATTLE_ERROR, and the error code is from the
@@ -332,12 +449,8 @@ cattle_program_load (CattleProgram  *self,
                      GError        **error)
 {
     CattleProgramPrivate *priv;
-    CattleInstruction    *instructions;
     CattleBuffer         *input;
-    gint8                 value;
-    glong                 brackets_count;
-    gulong                size;
-    gulong                i;
+    GArray               *nodes;
 
     g_return_val_if_fail (CATTLE_IS_PROGRAM (self), FALSE);
     g_return_val_if_fail (CATTLE_IS_BUFFER (buffer), FALSE);
@@ -346,52 +459,17 @@ cattle_program_load (CattleProgram  *self,
     priv = self->priv;
     g_return_val_if_fail (!priv->disposed, FALSE);
 
-    size = cattle_buffer_get_size (buffer);
-
-    /* Check the number of brackets to ensure the loops are balanced */
-    brackets_count = 0;
-    for (i = 0; i < size; i++)
-    {
-        value = cattle_buffer_get_value (buffer, i);
-
-        if (value == CATTLE_INSTRUCTION_LOOP_BEGIN)
-        {
-            brackets_count++;
-        }
-        else if (value == CATTLE_INSTRUCTION_LOOP_END)
-        {
-            brackets_count--;
-        }
-        else if (value == BANG_SYMBOL)
-        {
-            /* Brackets in the program's input should not
-             * be taken into account here */
-            break;
-        }
-    }
-
-    /* Report an error if the number of open brackets
-     * is not equal to the number of closed brackets */
-    if (brackets_count != 0)
+    /* Parse the program */
+    if (!load (buffer, &nodes, &input, error))
     {
-        g_set_error (error,
-                     CATTLE_ERROR,
-                     CATTLE_ERROR_UNBALANCED_BRACKETS,
-                     "Unbalanced brackets");
         return FALSE;
     }
 
-    /* Parse the program */
-    load (buffer,
-          0,
-          &instructions,
-          &input);
-
-    /* Set instructions and input */
-    cattle_program_set_instructions (self, instructions);
+    /* Set instructions and input. The instructions will only be
+     * created from the nodes if they're requested */
+    set_nodes (self, nodes);
     cattle_program_set_input (self, input);
 
-    g_object_unref (instructions);
     g_object_unref (input);
 
     return TRUE;
@@ -406,6 +484,11 @@ cattle_program_load (CattleProgram  *self,
  *
  * You shouldn't usually need to use this: see cattle_program_load()
  * for the standard way to load a program.
+ *
+ * The instructions are compiled the first time @program is run, and
+ * the result is reused for all subsequent runs: for this reason,
+ * changes made to the instructions afterwards are ignored until they
+ * are set again using this function.
  */
 void
 cattle_program_set_instructions (CattleProgram     *self,
@@ -419,11 +502,46 @@ cattle_program_set_instructions (CattleProgram     *self,
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    /* Release the reference held on the current instructions */
-    g_object_unref (priv->instructions);
+    /* Keep a reference to the instructions before releasing the
+     * current ones, in case they're the same */
+    g_object_ref (instructions);
+
+    set_nodes (self, NULL);
 
     priv->instructions = instructions;
-    g_object_ref (priv->instructions);
+}
+
+/* Get the compiled form of the instructions for @program, compiling
+ * them if that hasn't happened already. The caller owns a reference
+ * to the returned bytecode */
+CattleBytecode*
+cattle_program_get_bytecode (CattleProgram *self)
+{
+    CattleProgramPrivate *priv;
+    CattleBytecode       *bytecode;
+
+    g_return_val_if_fail (CATTLE_IS_PROGRAM (self), NULL);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, NULL);
+
+    bytecode = g_atomic_pointer_get (&priv->bytecode);
+
+    if (bytecode == NULL)
+    {
+        bytecode = cattle_bytecode_compile (get_nodes (self));
+
+        /* Same as for the nodes: only one compiled copy is kept */
+        if (!g_atomic_pointer_compare_and_exchange (&priv->bytecode,
+                                                    NULL,
+                                                    bytecode))
+        {
+            cattle_bytecode_unref (bytecode);
+            bytecode = g_atomic_pointer_get (&priv->bytecode);
+        }
+    }
+
+    return cattle_bytecode_ref (bytecode);
 }
 
 /**
@@ -433,22 +551,50 @@ cattle_program_set_instructions (CattleProgram     *self,
  * Get the instructions for @program.
  * See cattle_program_load() and cattle_program_set_instructions().
  *
+ * Programs loaded using cattle_program_load() are stored in a compact
+ * form, and their instructions are only created the first time this
+ * function is called.
+ *
+ * Changes made to the returned instructions don't affect @program
+ * until they are passed to cattle_program_set_instructions(), which
+ * causes them to be compiled again the next time @program is run.
+ *
  * Returns: (transfer full): the first instruction in @program
  */
 CattleInstruction*
 cattle_program_get_instructions (CattleProgram *self)
 {
     CattleProgramPrivate *priv;
+    CattleInstruction    *instructions;
 
     g_return_val_if_fail (CATTLE_IS_PROGRAM (self), NULL);
 
     priv = self->priv;
     g_return_val_if_fail (!priv->disposed, NULL);
 
+    instructions = g_atomic_pointer_get (&priv->instructions);
+
+    /* Create the instructions if they have only been stored as
+     * nodes so far. Reading them doesn't change @program, so the
+     * nodes and the compiled code are kept, and interpreters in other
+     * threads might be doing the same */
+    if (instructions == NULL)
+    {
+        instructions = cattle_node_expand (priv->nodes);
+
+        if (!g_atomic_pointer_compare_and_exchange (&priv->instructions,
+                                                    NULL,
+                                                    instructions))
+        {
+            g_object_unref (instructions);
+            instructions = g_atomic_pointer_get (&priv->instructions);
+        }
+    }
+
     /* Increase the reference count */
-    g_object_ref (priv->instructions);
+    g_object_ref (instructions);
 
-    return priv->instructions;
+    return instructions;
 }
 
 /**
@@ -505,6 +651,604 @@ cattle_program_get_input (CattleProgram *self)
     return priv->input;
 }
 
+/* Building blocks for C translations. Only the parts that are actually
+ * needed by a program are included, so that the result compiles
+ * cleanly.
+ *
+ * If the tape can grow, the range of cells that have been reached is
+ * tracked, for debugging purposes, and the tape grows when moving
+ * outside of it, just like #CattleTape does. Otherwise, the whole tape
+ * is allocated up front and moves are checked against its bounds */
+static const gchar *emit_c_header =
+"/* Generated by Cattle - https://kiyuko.org/software/cattle */\n"
+"\n"
+"#include <stdint.h>\n"
+"#include <stdio.h>\n"
+"#include <stdlib.h>\n"
+"#include <string.h>\n"
+"\n";
+
+static const gchar *emit_c_tape =
+"#define INITIAL_SIZE 256\n"
+"\n"
+"static cell *start;  /* First cell of the tape */\n"
+"static cell *end;    /* Past the last cell of the tape */\n"
+"static cell *first;  /* First cell reached so far */\n"
+"static cell *last;   /* Last cell reached so far */\n"
+"\n";
+
+static const gchar *emit_c_move =
+"/* Make room for before cells on the left of the tape and after\n"
+" * cells on its right, and return the new address of the cell p */\n"
+"static cell*\n"
+"resize (cell   *p,\n"
+"        size_t  before,\n"
+"        size_t  after)\n"
+"{\n"
+"    cell   *tape;\n"
+"    size_t  size;\n"
+"\n"
+"    size = end - start;\n"
+"    tape = calloc (before + size + after, sizeof (cell));\n"
+"\n"
+"    if (tape == NULL)\n"
+"    {\n"
+"        fputs (\"Out of memory\\n\", stderr);\n"
+"        exit (1);\n"
+"    }\n"
+"\n"
+"    memcpy (tape + before, start, size * sizeof (cell));\n"
+"\n"
+"    p = tape + before + (p - start);\n"
+"    first = tape + before + (first - start);\n"
+"    last = tape + before + (last - start);\n"
+"\n"
+"    free (start);\n"
+"    start = tape;\n"
+"    end = tape + before + size + after;\n"
+"\n"
+"    return p;\n"
+"}\n"
+"\n"
+"#define LEFT(n) \\\n"
+"    do { \\\n"
+"        if ((size_t) (p - start) < (n)) \\\n"
+"            p = resize (p, (n) + (end - start), 0); \\\n"
+"        p -= (n); \\\n"
+"        if (p < first) \\\n"
+"            first = p; \\\n"
+"    } while (0)\n"
+"\n"
+"#define RIGHT(n) \\\n"
+"    do { \\\n"
+"        if ((size_t) (end - p) <= (n)) \\\n"
+"            p = resize (p, 0, (n) + (end - start)); \\\n"
+"        p += (n); \\\n"
+"        if (p > last) \\\n"
+"            last = p; \\\n"
+"    } while (0)\n"
+"\n";
+
+/* All cells of a fixed-size tape count as reached */
+static const gchar *emit_c_fixed_range =
+"static cell *const first = tape;                  /* First cell of the tape */\n"
+"static cell *const last = tape + TAPE_SIZE - 1;  /* Last cell of the tape */\n"
+"\n";
+
+static const gchar *emit_c_fixed_move =
+"/* Stop the program, just like the interpreter does, when it tries\n"
+" * to move past either end of the tape */\n"
+"static void\n"
+"out_of_bounds (void)\n"
+"{\n"
+"    fflush (stdout);\n"
+"    fputs (\"Tape out of bounds\\n\", stderr);\n"
+"    exit (1);\n"
+"}\n"
+"\n"
+"#define LEFT(n) \\\n"
+"    do { \\\n"
+"        if ((size_t) (p - tape) < (n)) \\\n"
+"            out_of_bounds (); \\\n"
+"        p -= (n); \\\n"
+"    } while (0)\n"
+"\n"
+"#define RIGHT(n) \\\n"
+"    do { \\\n"
+"        if ((size_t) (tape + TAPE_SIZE - 1 - p) < (n)) \\\n"
+"            out_of_bounds (); \\\n"
+"        p += (n); \\\n"
+"    } while (0)\n"
+"\n";
+
+/* Only the lowest 8 bits of a cell are printed, as the interpreter
+ * does */
+static const gchar *emit_c_print =
+"static void\n"
+"output (cell          value,\n"
+"        unsigned long quantity)\n"
+"{\n"
+"    while (quantity-- > 0)\n"
+"    {\n"
+"        putchar ((unsigned char) value);\n"
+"    }\n"
+"}\n"
+"\n";
+
+static const gchar *emit_c_debug =
+"/* Print the contents of the tape, marking the current cell */\n"
+"static void\n"
+"debug (cell *p)\n"
+"{\n"
+"    cell *c;\n"
+"\n"
+"    fflush (stdout);\n"
+"    fputc ('[', stderr);\n"
+"\n"
+"    for (c = first; c <= last; c++)\n"
+"    {\n"
+"        if (c == p)\n"
+"            fputc ('<', stderr);\n"
+"\n"
+"        if (*c > ' ' && *c < 0x7f)\n"
+"            fputc (*c, stderr);\n"
+"        else\n"
+"            fprintf (stderr, \"0x%lX\", (unsigned long) *c);\n"
+"\n"
+"        if (c == p)\n"
+"            fputc ('>', stderr);\n"
+"\n"
+"        if (c != last)\n"
+"            fputc (' ', stderr);\n"
+"    }\n"
+"\n"
+"    fputs (\"]\\n\", stderr);\n"
+"}\n"
+"\n";
+
+/* Input is read from the standard input unless the program contains
+ * some, in which case that is used instead */
+static const gchar *emit_c_input_stdin =
+"static int end_of_input_reached;\n"
+"\n"
+"static int\n"
+"input (void)\n"
+"{\n"
+"    fflush (stdout);\n"
+"\n"
+"    return getchar ();\n"
+"}\n"
+"\n";
+
+static const gchar *emit_c_input_embedded =
+"static int    end_of_input_reached;\n"
+"static size_t input_offset;\n"
+"\n"
+"static int\n"
+"input (void)\n"
+"{\n"
+"    if (input_offset >= sizeof (input_data))\n"
+"    {\n"
+"        return EOF;\n"
+"    }\n"
+"\n"
+"    return input_data[input_offset++];\n"
+"}\n"
+"\n";
+
+/* The last value read is stored, and a value of 0xFF is treated as
+ * the end of input, as the interpreter does. Input is made of bytes
+ * even if cells are wider than that */
+static const gchar *emit_c_read_begin =
+"static void\n"
+"read_input (cell          *p,\n"
+"            unsigned long  quantity)\n"
+"{\n"
+"    int value;\n"
+"\n"
+"    value = 0;\n"
+"\n"
+"    while (quantity-- > 0)\n"
+"    {\n"
+"        if (!end_of_input_reached)\n"
+"        {\n"
+"            value = input ();\n"
+"        }\n"
+"\n"
+"        if (value == EOF)\n"
+"        {\n"
+"            end_of_input_reached = 1;\n"
+"        }\n"
+"    }\n"
+"\n"
+"    if (value == EOF || value == 0xFF)\n"
+"    {\n";
+
+static const gchar *emit_c_read_end =
+"    }\n"
+"    else\n"
+"    {\n"
+"        *p = value;\n"
+"    }\n"
+"}\n"
+"\n";
+
+static const gchar *emit_c_main =
+"int\n"
+"main (void)\n"
+"{\n"
+"    cell *p;\n"
+"\n"
+"    start = calloc (INITIAL_SIZE, sizeof (cell));\n"
+"\n"
+"    if (start == NULL)\n"
+"    {\n"
+"        fputs (\"Out of memory\\n\", stderr);\n"
+"        return 1;\n"
+"    }\n"
+"\n"
+"    end = start + INITIAL_SIZE;\n"
+"    first = start;\n"
+"    last = start;\n"
+"    p = start;\n"
+"\n";
+
+static const gchar *emit_c_fixed_main =
+"int\n"
+"main (void)\n"
+"{\n"
+"    cell *p;\n"
+"\n"
+"    p = tape;\n"
+"\n";
+
+static const gchar *emit_c_footer =
+"\n"
+"    fflush (stdout);\n"
+"    free (start);\n"
+"\n"
+"    return 0;\n"
+"}\n";
+
+static const gchar *emit_c_fixed_footer =
+"\n"
+"    fflush (stdout);\n"
+"\n"
+"    return 0;\n"
+"}\n";
+
+/* Append a line of code, indented by @level levels */
+static void
+emit_c_line (GString     *code,
+             gulong       level,
+             const gchar *format,
+             ...)
+{
+    va_list args;
+    gulong  i;
+
+    for (i = 0; i < level; i++)
+    {
+        g_string_append (code, "    ");
+    }
+
+    va_start (args, format);
+    g_string_append_vprintf (code, format, args);
+    va_end (args);
+
+    g_string_append_c (code, '\n');
+}
+
+/**
+ * cattle_program_emit_c:
+ * @program: a #CattleProgram
+ * @configuration: a #CattleConfiguration
+ * @error: (allow-none): return location for a #GError
+ *
+ * Translate @program to a standalone C program.
+ *
+ * The C program reads from the standard input, unless @program
+ * contains some input, writes to the standard output and dumps the
+ * tape on the standard error when a %CATTLE_INSTRUCTION_DEBUG
+ * instruction is executed, provided debugging is enabled, just like a
+ * #CattleInterpreter with the default handlers would.
+ *
+ * The cell width, the tape size and the end of input action set in
+ * @configuration are honored. A program trying to move past either end
+ * of a fixed-size tape is always stopped, printing an error message and
+ * exiting with a non-zero status, even if bounds checking is disabled.
+ * The engine and the input buffer size don't change the result.
+ *
+ * If @program contains unbalanced brackets, %NULL is returned and
+ * @error is set to %CATTLE_ERROR_UNBALANCED_BRACKETS.
+ *
+ * Returns: (transfer full): the source code of the C program, or %NULL
+ * on failure
+ */
+gchar*
+cattle_program_emit_c (CattleProgram        *self,
+                       CattleConfiguration  *configuration,
+                       GError              **error)
+{
+    CattleProgramPrivate   *priv;
+    CattleNode             *node;
+    GArray                 *nodes;
+    GString                *body;
+    GString                *code;
+    const gint8            *data;
+    const gchar            *type;
+    gboolean                debug;
+    gboolean                fixed;
+    gboolean                balanced;
+    gboolean                needs_move;
+    gboolean                needs_read;
+    gboolean                needs_print;
+    gboolean                needs_debug;
+    gulong                  quantity;
+    gulong                  size;
+    gulong                  tape_size;
+    gulong                  depth;
+    gulong                  level;
+    gulong                  i;
+    guint                   n;
+
+    g_return_val_if_fail (CATTLE_IS_PROGRAM (self), NULL);
+    g_return_val_if_fail (CATTLE_IS_CONFIGURATION (configuration), NULL);
+    g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, NULL);
+
+    debug = cattle_configuration_get_debug_is_enabled (configuration);
+    tape_size = cattle_configuration_get_tape_size (configuration);
+    fixed = (tape_size > 0);
+
+    switch (cattle_configuration_get_cell_width (configuration))
+    {
+        case CATTLE_CELL_WIDTH_16:
+
+            type = "uint16_t";
+            break;
+
+        case CATTLE_CELL_WIDTH_32:
+
+            type = "uint32_t";
+            break;
+
+        case CATTLE_CELL_WIDTH_8:
+        default:
+
+            type = "uint8_t";
+            break;
+    }
+
+    needs_move = FALSE;
+    needs_read = FALSE;
+    needs_print = FALSE;
+    needs_debug = FALSE;
+
+    /* Translate instructions one at a time. Nodes are already in the
+     * right order, so only the nesting level has to be tracked */
+    nodes = get_nodes (self);
+    body = g_string_new ("");
+    depth = 0;
+    level = 1;
+    balanced = TRUE;
+
+    for (n = 0; n < nodes->len && balanced; n++)
+    {
+        node = &g_array_index (nodes, CattleNode, n);
+        quantity = node->quantity;
+
+        switch (node->value)
+        {
+            case CATTLE_INSTRUCTION_LOOP_BEGIN:
+
+                emit_c_line (body, level, "while (*p)");
+                emit_c_line (body, level, "{");
+                level++;
+                depth++;
+
+                break;
+
+            case CATTLE_INSTRUCTION_LOOP_END:
+
+                /* Closing a loop that was never opened */
+                if (depth == 0)
+                {
+                    balanced = FALSE;
+                    break;
+                }
+
+                level--;
+                depth--;
+                emit_c_line (body, level, "}");
+
+                break;
+
+            case CATTLE_INSTRUCTION_MOVE_LEFT:
+
+                emit_c_line (body, level, "LEFT (%luUL);", quantity);
+                needs_move = TRUE;
+
+                break;
+
+            case CATTLE_INSTRUCTION_MOVE_RIGHT:
+
+                emit_c_line (body, level, "RIGHT (%luUL);", quantity);
+                needs_move = TRUE;
+
+                break;
+
+            case CATTLE_INSTRUCTION_INCREASE:
+
+                emit_c_line (body, level, "*p += %lu;", quantity);
+
+                break;
+
+            case CATTLE_INSTRUCTION_DECREASE:
+
+                emit_c_line (body, level, "*p -= %lu;", quantity);
+
+                break;
+
+            case CATTLE_INSTRUCTION_READ:
+
+                emit_c_line (body, level, "read_input (p, %luUL);", quantity);
+                needs_read = TRUE;
+
+                break;
+
+            case CATTLE_INSTRUCTION_PRINT:
+
+                emit_c_line (body, level, "output (*p, %luUL);", quantity);
+                needs_print = TRUE;
+
+                break;
+
+            case CATTLE_INSTRUCTION_DEBUG:
+
+                /* Debug instructions are only translated if debugging
+                 * is enabled in the configuration */
+                if (debug)
+                {
+                    for (i = 0; i < quantity; i++)
+                    {
+                        emit_c_line (body, level, "debug (p);");
+                    }
+                    needs_debug = TRUE;
+                }
+
+                break;
+
+            case CATTLE_NODE_UNBALANCED:
+            default:
+
+                /* Either a loop was closed without being opened or
+                 * it was never closed */
+                balanced = FALSE;
+
+                break;
+        }
+    }
+
+    if (!balanced)
+    {
+        g_string_free (body, TRUE);
+
+        g_set_error_literal (error,
+                             CATTLE_ERROR,
+                             CATTLE_ERROR_UNBALANCED_BRACKETS,
+                             "Unbalanced brackets");
+
+        return NULL;
+    }
+
+    /* Put together the parts needed by the program. Values are
+     * updated modulo the size of the cell type */
+    code = g_string_new (emit_c_header);
+    g_string_append_printf (code, "typedef %s cell;\n\n", type);
+
+    if (fixed)
+    {
+        g_string_append_printf (code, "#define TAPE_SIZE %luUL\n\n", tape_size);
+        g_string_append (code, "static cell tape[TAPE_SIZE];\n\n");
+
+        if (needs_move)
+        {
+            g_string_append (code, emit_c_fixed_move);
+        }
+        if (needs_debug)
+        {
+            g_string_append (code, emit_c_fixed_range);
+        }
+    }
+    else
+    {
+        g_string_append (code, emit_c_tape);
+
+        if (needs_move)
+        {
+            g_string_append (code, emit_c_move);
+        }
+    }
+
+    if (needs_print)
+    {
+        g_string_append (code, emit_c_print);
+    }
+    if (needs_debug)
+    {
+        g_string_append (code, emit_c_debug);
+    }
+
+    if (needs_read)
+    {
+        /* Embed the input, if any */
+        size = cattle_buffer_get_size (priv->input);
+        data = cattle_buffer_peek_contents (priv->input);
+
+        if (size > 0)
+        {
+            g_string_append (code, "static const unsigned char input_data[] = {");
+
+            for (i = 0; i < size; i++)
+            {
+                if (i % 12 == 0)
+                {
+                    g_string_append (code, "\n   ");
+                }
+                g_string_append_printf (code,
+                                        " 0x%02X,",
+                                        (guint8) data[i]);
+            }
+
+            g_string_append (code, "\n};\n\n");
+            g_string_append (code, emit_c_input_embedded);
+        }
+        else
+        {
+            g_string_append (code, emit_c_input_stdin);
+        }
+
+        /* What happens at the end of input depends on the
+         * configuration */
+        g_string_append (code, emit_c_read_begin);
+
+        switch (cattle_configuration_get_end_of_input_action (configuration))
+        {
+            case CATTLE_END_OF_INPUT_ACTION_STORE_EOF:
+
+                /* The value is sign-extended to the cell width */
+                g_string_append_printf (code,
+                                        "        *p = (cell) %d;\n",
+                                        CATTLE_EOF);
+                break;
+
+            case CATTLE_END_OF_INPUT_ACTION_DO_NOTHING:
+
+                g_string_append (code, "        /* Do nothing */\n");
+                break;
+
+            case CATTLE_END_OF_INPUT_ACTION_STORE_ZERO:
+            default:
+
+                g_string_append (code, "        *p = 0;\n");
+                break;
+        }
+
+        g_string_append (code, emit_c_read_end);
+    }
+
+    g_string_append (code, fixed ? emit_c_fixed_main : emit_c_main);
+    g_string_append_len (code, body->str, body->len);
+    g_string_append (code, fixed ? emit_c_fixed_footer : emit_c_footer);
+
+    g_string_free (body, TRUE);
+
+    return g_string_free (code, FALSE);
+}
+
 static void
 cattle_program_set_property (GObject      *object,
                              guint         property_id,
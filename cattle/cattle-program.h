@@ -27,6 +27,7 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <cattle/cattle-buffer.h>
+#include <cattle/cattle-configuration.h>
 #include <cattle/cattle-instruction.h>
 
 G_BEGIN_DECLS
@@ -54,15 +55,18 @@ struct _CattleProgramClass
 };
 
 CattleProgram*     cattle_program_new              (void);
-gboolean           cattle_program_load             (CattleProgram      *program,
-                                                    CattleBuffer       *buffer,
-                                                    GError            **error);
-void               cattle_program_set_instructions (CattleProgram      *program,
-                                                    CattleInstruction  *instructions);
-CattleInstruction* cattle_program_get_instructions (CattleProgram      *program);
-void               cattle_program_set_input        (CattleProgram      *program,
-                                                    CattleBuffer       *input);
-CattleBuffer*      cattle_program_get_input        (CattleProgram      *program);
+gboolean           cattle_program_load             (CattleProgram        *program,
+                                                    CattleBuffer         *buffer,
+                                                    GError              **error);
+void               cattle_program_set_instructions (CattleProgram        *program,
+                                                    CattleInstruction    *instructions);
+CattleInstruction* cattle_program_get_instructions (CattleProgram        *program);
+void               cattle_program_set_input        (CattleProgram        *program,
+                                                    CattleBuffer         *input);
+CattleBuffer*      cattle_program_get_input        (CattleProgram        *program);
+gchar*             cattle_program_emit_c           (CattleProgram        *program,
+                                                    CattleConfiguration  *configuration,
+                                                    GError              **error);
 
 GType              cattle_program_get_type         (void) G_GNUC_CONST;
 
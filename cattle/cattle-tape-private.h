@@ -0,0 +1,54 @@
+/* Cattle - Brainfuck language toolkit
+ * Copyright (C) 2008-2020  Andrea Bolognani <eof@kiyuko.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * Homepage: https://kiyuko.org/software/cattle
+ */
+
+#if !defined (CATTLE_COMPILATION)
+#error "This header is private to Cattle and can't be included directly."
+#endif
+
+#ifndef __CATTLE_TAPE_PRIVATE_H__
+#define __CATTLE_TAPE_PRIVATE_H__
+
+#include <glib.h>
+#include "cattle-configuration.h"
+#include "cattle-tape.h"
+
+G_BEGIN_DECLS
+
+gint8*   cattle_tape_get_current_cell (CattleTape       *tape,
+                                       gint8           **first,
+                                       gint8           **last);
+gboolean cattle_tape_set_current_cell (CattleTape       *tape,
+                                       gint8            *cell);
+gboolean cattle_tape_set_size         (CattleTape       *tape,
+                                       gulong            size);
+void     cattle_tape_set_cell_width   (CattleTape       *tape,
+                                       CattleCellWidth   width);
+gboolean cattle_tape_can_move_left    (CattleTape       *tape,
+                                       gulong            steps);
+gboolean cattle_tape_can_move_right   (CattleTape       *tape,
+                                       gulong            steps);
+gboolean cattle_tape_scan_left        (CattleTape       *tape,
+                                       gulong            stride);
+gboolean cattle_tape_scan_right       (CattleTape       *tape,
+                                       gulong            stride);
+gulong   cattle_tape_get_guard_size   (CattleTape       *tape);
+
+G_END_DECLS
+
+#endif /* __CATTLE_TAPE_PRIVATE_H__ */
@@ -18,7 +18,14 @@
  */
 
 #include "cattle-tape.h"
-#include "cattle-buffer.h"
+#include "cattle-tape-private.h"
+#include <string.h>
+
+#if defined (__unix__)
+#define HAVE_MMAP 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /**
  * SECTION:cattle-tape
@@ -27,7 +34,8 @@
  * A #CattleTape represents an infinte-length memory tape, which is used
  * by a #CattleInterpreter to store its data. The tape contains a
  * virtually infinte number of memory cells, each one able to store a
- * single byte.
+ * single byte unless a wider cell width has been configured using
+ * cattle_configuration_set_cell_width().
  *
  * A tape supports three kinds of operations: reading the value of the
  * current cell, updating the value of the current cell (either by
@@ -38,6 +46,16 @@
  * being the amount of available memory. It is possible to check if the
  * current cell is at the beginning or at the end of the tape using
  * cattle_tape_is_at_beginning() and cattle_tape_is_at_end().
+ *
+ * Whole ranges of cells can be copied in and out of the tape at once
+ * using cattle_tape_get_values() and cattle_tape_set_values(), or
+ * inspected in place using cattle_tape_peek_values(), without moving
+ * the current cell pointer.
+ *
+ * The tape used by a #CattleInterpreter can also be given a fixed size
+ * using cattle_configuration_set_tape_size(): in that case, all cells
+ * are allocated before the program is run, and moving past either end
+ * of the tape is not allowed.
  */
 
 /**
@@ -47,20 +65,37 @@
  * be accessed directly.
  */
 
+/**
+ * CattleTapePosition:
+ *
+ * A position on a #CattleTape, saved using cattle_tape_save_position().
+ * It can be copied freely, but its contents should never be accessed
+ * directly.
+ */
+
 struct _CattleTapePrivate
 {
     gboolean  disposed;
 
-    GList    *current;     /* Current chunk */
-    GList    *head;        /* First chunk */
+    gint8    *data;      /* Storage for all cells */
+    gulong    size;      /* Number of cells in the storage */
+    guint     shift;     /* Each cell takes 1 << shift bytes */
+    gulong    origin;    /* Index of the cell the tape started from,
+                          * which changes when the tape grows to the
+                          * left */
+
+    gpointer  mapping;   /* Memory mapping containing the storage,
+                          * or NULL if it's been allocated normally */
+    gsize     length;    /* Length of the memory mapping */
 
-    gulong    offset;      /* Offset of the current cell */
-    gulong    lower_limit; /* Offset of the first valid byte
-                            * inside the first chunk */
-    gulong    upper_limit; /* Offset of the last valid byte inside
-                            * the last chunk */
+    gint8    *current;   /* Current cell */
+    gint8    *first;     /* First cell that has been reached */
+    gint8    *last;      /* Last cell that has been reached */
 
-    GSList   *bookmarks;   /* Bookmarks stack */
+    gboolean  fixed;     /* Whether the tape can't grow */
+
+    GArray   *bookmarks; /* Bookmarks stack, made of positions
+                          * relative to the origin */
 };
 
 G_DEFINE_TYPE_WITH_CODE (CattleTape, cattle_tape, G_TYPE_OBJECT,
@@ -72,16 +107,123 @@ enum {
     PROP_CURRENT_VALUE
 };
 
-typedef struct _CattleTapeBookmark CattleTapeBookmark;
+/* Initial number of cells. The storage grows geometrically from there
+ * as more cells are needed */
+#define INITIAL_SIZE 256
+
+/* Initial size of the storage, in bytes, when memory can be mapped.
+ * Pages are only committed when they're first touched, so reserving
+ * some address space up front costs little and means most programs
+ * never cause the tape to be moved. The size is the same regardless of
+ * the cell width, and small enough that creating many tapes doesn't
+ * exhaust the address space */
+#define RESERVED_SIZE (sizeof (gpointer) >= 8 ? (1UL << 24) : (1UL << 20))
+
+/* Map @size bytes of zero-filled storage, surrounded by inaccessible
+ * guard pages: a program that is trusted not to move past either end
+ * of a fixed-size tape, and does anyway, crashes instead of silently
+ * corrupting unrelated memory.
+ *
+ * Memory can only be protected a page at a time, so the storage is
+ * placed at the end of the accessible pages: the last cell is followed
+ * directly by the guard page, but unless @size is a multiple of the
+ * page size, there is some unused memory between the first cell and
+ * the guard page before it. Returns NULL if memory can't be mapped */
+static gint8*
+storage_map (gulong     size,
+             gpointer  *mapping,
+             gsize     *length)
+{
+#ifdef HAVE_MMAP
+    gpointer memory;
+    gsize    page_size;
+    gsize    pages;
+    gint     flags;
+
+    page_size = sysconf (_SC_PAGESIZE);
+    pages = (size / page_size) + ((size % page_size) ? 1 : 0);
+
+    if (pages > (G_MAXSIZE / page_size) - 2)
+    {
+        return NULL;
+    }
+
+    /* The whole mapping starts out inaccessible, then everything but
+     * the first and the last page is made accessible */
+    flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+
+    memory = mmap (NULL,
+                   (pages + 2) * page_size,
+                   PROT_NONE,
+                   flags,
+                   -1,
+                   0);
+
+    if (memory == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    if (mprotect ((gint8 *) memory + page_size,
+                  pages * page_size,
+                  PROT_READ | PROT_WRITE) != 0)
+    {
+        munmap (memory, (pages + 2) * page_size);
+
+        return NULL;
+    }
+
+    *mapping = memory;
+    *length = (pages + 2) * page_size;
+
+    return (gint8 *) memory + ((pages + 1) * page_size) - size;
+#else
+    return NULL;
+#endif
+}
 
-struct _CattleTapeBookmark
+/* Allocate @size bytes of zero-filled storage, mapping it if
+ * possible. @mapping is set to NULL if memory couldn't be mapped */
+static gint8*
+storage_new (gulong     size,
+             gpointer  *mapping,
+             gsize     *length)
 {
-    GList   *chunk;
-    gulong   offset;
-};
+    gint8 *data;
+
+    data = storage_map (size, mapping, length);
+
+    if (data == NULL)
+    {
+        *mapping = NULL;
+        *length = 0;
+
+        data = g_new0 (gint8, size);
+    }
+
+    return data;
+}
+
+/* Release storage obtained through storage_new() */
+static void
+storage_free (gint8    *data,
+              gpointer  mapping,
+              gsize     length)
+{
+#ifdef HAVE_MMAP
+    if (mapping != NULL)
+    {
+        munmap (mapping, length);
+
+        return;
+    }
+#endif
 
-/* Size of the tape chunk */
-#define CHUNK_SIZE 256
+    g_free (data);
+}
 
 static void
 cattle_tape_init (CattleTape *self)
@@ -90,33 +232,39 @@ cattle_tape_init (CattleTape *self)
 
     priv = cattle_tape_get_instance_private (self);
 
-    priv->head = NULL;
-    priv->current = NULL;
+    /* Create the initial storage, falling back to a much smaller one
+     * if a large region can't be mapped. Cells are 8 bits wide until
+     * cattle_tape_set_cell_width() is called */
+    priv->size = RESERVED_SIZE;
+    priv->shift = 0;
+    priv->data = storage_map (priv->size, &(priv->mapping), &(priv->length));
+
+    if (priv->data == NULL)
+    {
+        priv->size = INITIAL_SIZE;
+        priv->data = storage_new (priv->size, &(priv->mapping), &(priv->length));
+    }
 
-    /* Create the first chunk */
-    priv->head = g_list_append (priv->head, (gpointer) cattle_buffer_new (CHUNK_SIZE));
-    priv->current = priv->head;
+    /* Start in the middle, so that the tape can grow in either
+     * direction without being moved */
+    priv->origin = priv->size / 2;
 
     /* Set the initial limits */
-    priv->offset = 0;
-    priv->lower_limit = 0;
-    priv->upper_limit = 0;
+    priv->current = priv->data + priv->origin;
+    priv->first = priv->current;
+    priv->last = priv->current;
 
-    /* Initialize the bookmarks stack */
-    priv->bookmarks = NULL;
+    priv->fixed = FALSE;
+
+    /* Initialize the bookmarks stack. Pushing and popping bookmarks
+     * doesn't allocate memory once the array has grown enough */
+    priv->bookmarks = g_array_sized_new (FALSE, FALSE, sizeof (glong), 16);
 
     priv->disposed = FALSE;
 
     self->priv = priv;
 }
 
-static void
-chunk_unref (gpointer chunk,
-             gpointer data G_GNUC_UNUSED)
-{
-    g_object_unref (G_OBJECT (chunk));
-}
-
 static void
 cattle_tape_dispose (GObject *object)
 {
@@ -128,20 +276,11 @@ cattle_tape_dispose (GObject *object)
 
     g_return_if_fail (!priv->disposed);
 
-    g_list_foreach (priv->head, (GFunc) chunk_unref, NULL);
-
     priv->disposed = TRUE;
 
     G_OBJECT_CLASS (cattle_tape_parent_class)->dispose (object);
 }
 
-static void
-bookmark_free (gpointer bookmark,
-               gpointer data G_GNUC_UNUSED)
-{
-    g_free (bookmark);
-}
-
 static void
 cattle_tape_finalize (GObject *object)
 {
@@ -151,14 +290,140 @@ cattle_tape_finalize (GObject *object)
     self = CATTLE_TAPE (object);
     priv = self->priv;
 
-    g_slist_foreach (priv->bookmarks, (GFunc) bookmark_free, NULL);
-
-    g_list_free (priv->head);
-    g_slist_free (priv->bookmarks);
+    storage_free (priv->data, priv->mapping, priv->length);
+    g_array_free (priv->bookmarks, TRUE);
 
     G_OBJECT_CLASS (cattle_tape_parent_class)->finalize (object);
 }
 
+/* Make room for at least @before cells on the left of the current one
+ * and @after cells on its right. The storage grows at least by its own
+ * size on each side that needs more room, so that moving across the
+ * whole tape only causes a logarithmic number of reallocations */
+static void
+reserve (CattleTapePrivate *priv,
+         gulong             before,
+         gulong             after)
+{
+    gint8    *data;
+    gpointer  mapping;
+    gsize     length;
+    gulong    current;
+    gulong    first;
+    gulong    last;
+    gulong    grow_before;
+    gulong    grow_after;
+    gulong    limit;
+
+    current = (priv->current - priv->data) >> priv->shift;
+    first = (priv->first - priv->data) >> priv->shift;
+    last = (priv->last - priv->data) >> priv->shift;
+
+    grow_before = 0;
+    grow_after = 0;
+
+    if (before > current)
+    {
+        grow_before = MAX (before - current, priv->size);
+    }
+    if (after > priv->size - current - 1)
+    {
+        grow_after = MAX (after - (priv->size - current - 1), priv->size);
+    }
+
+    if (grow_before == 0 && grow_after == 0)
+    {
+        return;
+    }
+
+    /* The size of the storage in bytes must fit as well */
+    limit = G_MAXULONG >> priv->shift;
+
+    if (grow_after > limit - priv->size ||
+        grow_before > limit - priv->size - grow_after)
+    {
+        g_error ("Tape size overflow");
+    }
+
+    /* Only the cells that have been reached need to be copied, all
+     * others are still zero */
+    data = storage_new ((priv->size + grow_before + grow_after) << priv->shift,
+                        &mapping,
+                        &length);
+    memcpy (data + ((grow_before + first) << priv->shift),
+            priv->first,
+            (last - first + 1) << priv->shift);
+    storage_free (priv->data, priv->mapping, priv->length);
+
+    priv->data = data;
+    priv->mapping = mapping;
+    priv->length = length;
+    priv->size += grow_before + grow_after;
+    priv->origin += grow_before;
+
+    priv->current = data + ((grow_before + current) << priv->shift);
+    priv->first = data + ((grow_before + first) << priv->shift);
+    priv->last = data + ((grow_before + last) << priv->shift);
+}
+
+/* Get the value of @cell, which is 1 << @shift bytes wide */
+static inline gint32
+cell_get (const gint8 *cell,
+          guint        shift)
+{
+    switch (shift)
+    {
+        case 1:
+            return *((const gint16 *) cell);
+        case 2:
+            return *((const gint32 *) cell);
+        default:
+            return *cell;
+    }
+}
+
+/* Set the value of @cell, which is 1 << @shift bytes wide, keeping
+ * only as many bits of @value as it can hold */
+static inline void
+cell_set (gint8  *cell,
+          guint   shift,
+          gint32  value)
+{
+    switch (shift)
+    {
+        case 1:
+            *((guint16 *) cell) = (guint16) value;
+            break;
+        case 2:
+            *((guint32 *) cell) = (guint32) value;
+            break;
+        default:
+            *((guint8 *) cell) = (guint8) value;
+            break;
+    }
+}
+
+/* Add @amount to the value of @cell, which is 1 << @shift bytes
+ * wide, wrapping around on overflow */
+static inline void
+cell_add (gint8   *cell,
+          guint    shift,
+          guint32  amount)
+{
+    switch (shift)
+    {
+        case 1:
+            *((guint16 *) cell) += amount;
+            break;
+        case 2:
+            *((guint32 *) cell) += amount;
+            break;
+        default:
+            *((guint8 *) cell) += amount;
+            break;
+    }
+}
+
 /**
  * cattle_tape_new:
  *
@@ -179,23 +444,21 @@ cattle_tape_new (void)
  *
  * Set the value of the current cell.
  *
- * Accepted values range from %G_MININT8 to %G_MAXINT8.
+ * Accepted values range from %G_MININT8 to %G_MAXINT8. If the cells
+ * of @tape are wider than 8 bits, @value is sign-extended.
  */
 void
 cattle_tape_set_current_value (CattleTape *self,
                                gint8       value)
 {
     CattleTapePrivate *priv;
-    CattleBuffer      *chunk;
 
     g_return_if_fail (CATTLE_IS_TAPE (self));
 
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    chunk = CATTLE_BUFFER (priv->current->data);
-
-    cattle_buffer_set_value (chunk, priv->offset, value);
+    cell_set (priv->current, priv->shift, value);
 }
 
 /**
@@ -205,22 +468,70 @@ cattle_tape_set_current_value (CattleTape *self,
  * Get the value of the current cell. See
  * cattle_tape_set_current_value().
  *
+ * If the cells of @tape are wider than 8 bits, only the lowest 8 bits
+ * of the value are returned: use cattle_tape_get_current_wide_value()
+ * to get the whole value.
+ *
  * Returns: the value of the current cell
  */
 gint8
 cattle_tape_get_current_value (CattleTape *self)
 {
     CattleTapePrivate *priv;
-    CattleBuffer      *chunk;
 
     g_return_val_if_fail (CATTLE_IS_TAPE (self), 0);
 
     priv = self->priv;
     g_return_val_if_fail (!priv->disposed, 0);
 
-    chunk = CATTLE_BUFFER (priv->current->data);
+    return (gint8) cell_get (priv->current, priv->shift);
+}
+
+/**
+ * cattle_tape_set_current_wide_value:
+ * @tape: a #CattleTape
+ * @value: the current cell's new value
+ *
+ * Set the value of the current cell.
+ *
+ * Only as many bits of @value as a cell can hold are stored: for the
+ * usual 8 bit cells, this is the same as calling
+ * cattle_tape_set_current_value() with the lowest 8 bits of @value.
+ */
+void
+cattle_tape_set_current_wide_value (CattleTape *self,
+                                    gint32      value)
+{
+    CattleTapePrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_TAPE (self));
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    cell_set (priv->current, priv->shift, value);
+}
+
+/**
+ * cattle_tape_get_current_wide_value:
+ * @tape: a #CattleTape
+ *
+ * Get the whole value of the current cell, sign-extended to 32 bits.
+ * See cattle_tape_set_current_wide_value().
+ *
+ * Returns: the value of the current cell
+ */
+gint32
+cattle_tape_get_current_wide_value (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), 0);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, 0);
 
-    return cattle_buffer_get_value (chunk, priv->offset);
+    return cell_get (priv->current, priv->shift);
 }
 
 /**
@@ -250,24 +561,13 @@ cattle_tape_increase_current_value_by (CattleTape *self,
                                        gulong      value)
 {
     CattleTapePrivate *priv;
-    CattleBuffer      *chunk;
-    gint8              current;
 
     g_return_if_fail (CATTLE_IS_TAPE (self));
 
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    /* Return right away if no increment is needed */
-    if (value == 0)
-    {
-        return;
-    }
-
-    chunk = CATTLE_BUFFER (priv->current->data);
-
-    current = cattle_buffer_get_value (chunk, priv->offset);
-    cattle_buffer_set_value (chunk, priv->offset, current + value);
+    cell_add (priv->current, priv->shift, value);
 }
 
 /**
@@ -297,24 +597,13 @@ cattle_tape_decrease_current_value_by (CattleTape *self,
                                        gulong      value)
 {
     CattleTapePrivate *priv;
-    CattleBuffer      *chunk;
-    gint8              current;
 
     g_return_if_fail (CATTLE_IS_TAPE (self));
 
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    /* Return right away if no decrement is needed */
-    if (value == 0)
-    {
-        return;
-    }
-
-    chunk = CATTLE_BUFFER (priv->current->data);
-
-    current = cattle_buffer_get_value (chunk, priv->offset);
-    cattle_buffer_set_value (chunk, priv->offset, current - value);
+    cell_add (priv->current, priv->shift, -value);
 }
 
 /**
@@ -340,48 +629,38 @@ cattle_tape_move_left (CattleTape *self)
  * Move @tape @steps cells to the left.
  *
  * Moving this way is much faster than calling
- * cattle_tape_move_left() multiple times.
+ * cattle_tape_move_left() multiple times: it takes the same time
+ * regardless of @steps, unless the tape has to grow, in which case
+ * only the cells that have already been reached are copied.
+ *
+ * If @tape has a fixed size, it can't be moved past its first cell.
  */
 void
 cattle_tape_move_left_by (CattleTape *self,
                           gulong      steps)
 {
     CattleTapePrivate *priv;
-    CattleBuffer      *chunk;
 
     g_return_if_fail (CATTLE_IS_TAPE (self));
 
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    /* Move backwards until the correct chunk is found */
-    while (steps > priv->offset)
+    /* Cells that have already been reached don't require any work */
+    if (steps <= (gulong) ((priv->current - priv->first) >> priv->shift))
     {
-        /* If there is no previous chunk, create it */
-        if (g_list_previous (priv->current) == NULL)
-        {
-            chunk = cattle_buffer_new (CHUNK_SIZE);
-            priv->head = g_list_prepend (priv->head, chunk);
-            priv->lower_limit = CHUNK_SIZE - 1;
-        }
+        priv->current -= steps << priv->shift;
 
-        priv->current = g_list_previous (priv->current);
-
-        steps -= (priv->offset + 1);
-        priv->offset = CHUNK_SIZE - 1;
+        return;
     }
 
-    priv->offset -= steps;
+    /* Fixed-size tapes can't grow */
+    g_return_if_fail (!priv->fixed);
 
-    /* If the current chunk is the first one, the lower limit
-     * might need to be updated */
-    if (g_list_previous (priv->current) == NULL)
-    {
-        if (priv->offset < priv->lower_limit)
-        {
-            priv->lower_limit = priv->offset;
-        }
-    }
+    reserve (priv, steps, 0);
+
+    priv->current -= steps << priv->shift;
+    priv->first = priv->current;
 }
 
 /**
@@ -407,182 +686,920 @@ cattle_tape_move_right (CattleTape *self)
  * Move @tape @steps cells to the right.
  *
  * Moving this way is much faster than calling
- * cattle_tape_move_right() multiple times.
+ * cattle_tape_move_right() multiple times: it takes the same time
+ * regardless of @steps, unless the tape has to grow, in which case
+ * only the cells that have already been reached are copied.
+ *
+ * If @tape has a fixed size, it can't be moved past its last cell.
  */
 void
 cattle_tape_move_right_by (CattleTape *self,
                            gulong      steps)
 {
     CattleTapePrivate *priv;
-    CattleBuffer      *chunk;
 
     g_return_if_fail (CATTLE_IS_TAPE (self));
 
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    /* Move forward until the correct chunk is found */
-    while (priv->offset + steps >= CHUNK_SIZE )
+    /* Cells that have already been reached don't require any work */
+    if (steps <= (gulong) ((priv->last - priv->current) >> priv->shift))
     {
-        /* If there is no next chunk, create it */
-        if (g_list_next (priv->current) == NULL)
-        {
-            chunk = cattle_buffer_new (CHUNK_SIZE);
-            priv->head = g_list_append (priv->head, chunk);
-            priv->upper_limit = 0;
-        }
+        priv->current += steps << priv->shift;
 
-        priv->current = g_list_next (priv->current);
-
-        steps -= (CHUNK_SIZE - priv->offset);
-        priv->offset = 0;
+        return;
     }
 
-    priv->offset += steps;
+    /* Fixed-size tapes can't grow */
+    g_return_if_fail (!priv->fixed);
 
-    /* If the current chunk is the last one, the upper limit
-     * might need to be updated */
-    if (g_list_next (priv->current) == NULL)
-    {
-        if (priv->offset > priv->upper_limit)
-        {
-            priv->upper_limit = priv->offset;
-        }
-    }
+    reserve (priv, 0, steps);
+
+    priv->current += steps << priv->shift;
+    priv->last = priv->current;
 }
 
-/**
- * cattle_tape_is_at_beginning:
- * @tape: a #CattleTape
+/* Get a pointer to the current cell, along with the first and last
+ * cells it can be moved to without going through cattle_tape_move_left_by()
+ * and cattle_tape_move_right_by().
  *
- * Check if the current cell is the first one of @tape.
+ * The range covers all cells that have already been reached, so that
+ * moving inside it never requires the tape to grow or its limits to be
+ * updated.
  *
- * Since the tape grows automatically as more cells are needed, it is
- * possible to move left from the first cell.
+ * The pointers point to the first byte of each cell; all cells have
+ * the width last set using cattle_tape_set_cell_width(), and are 8 bits
+ * wide by default.
  *
- * Returns: %TRUE if the current cell is the first one, %FALSE otherwise
- */
+ * The pointers are valid until the tape is modified through any other
+ * method; cattle_tape_set_current_cell() has to be called before that
+ * happens if the current cell has been moved in the meantime */
+gint8*
+cattle_tape_get_current_cell (CattleTape  *self,
+                              gint8      **first,
+                              gint8      **last)
+{
+    CattleTapePrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), NULL);
+    g_return_val_if_fail (first != NULL, NULL);
+    g_return_val_if_fail (last != NULL, NULL);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, NULL);
+
+    *first = priv->first;
+    *last = priv->last;
+
+    return priv->current;
+}
+
+/* Make @cell the current cell. @cell should be inside the range
+ * returned by the last call to cattle_tape_get_current_cell(), but a
+ * program that is trusted not to move past either end of a fixed-size
+ * tape might have done so anyway: in that case, the tape is left
+ * untouched and FALSE is returned */
 gboolean
-cattle_tape_is_at_beginning (CattleTape *self)
+cattle_tape_set_current_cell (CattleTape *self,
+                              gint8      *cell)
 {
     CattleTapePrivate *priv;
-    gboolean           check;
 
     g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
 
     priv = self->priv;
     g_return_val_if_fail (!priv->disposed, FALSE);
 
-    /* If the current chunk is the first one and the current offset
-     * is equal to the lower limit, we are at the beginning of the
-     * tape */
-    if (g_list_previous (priv->current) == NULL && (priv->offset == priv->lower_limit))
-    {
-        check = TRUE;
-    }
-    else
+    if (cell < priv->first || cell > priv->last)
     {
-        check = FALSE;
+        return FALSE;
     }
 
-    return check;
+    priv->current = cell;
+
+    return TRUE;
 }
 
-/**
- * cattle_tape_is_at_end:
- * @tape: a #CattleTape
- *
- * Check if the current cell is the last one of @tape.
- * 
- * Since the tape grows automatically as more cells are needed, it is
- * possible to move right from the last cell.
+/* Make @tape fixed-size, with @size cells, or let it grow again if
+ * @size is zero.
  *
- * Returns: %TRUE if the current cell is the last one, %FALSE otherwise
- */
+ * The cells that have already been reached are kept, with the first
+ * one becoming the first cell of the fixed-size tape. Returns FALSE,
+ * leaving the tape untouched, if they don't fit */
 gboolean
-cattle_tape_is_at_end (CattleTape *self)
+cattle_tape_set_size (CattleTape *self,
+                      gulong      size)
 {
     CattleTapePrivate *priv;
-    gboolean           check;
+    gint8             *data;
+    gpointer           mapping;
+    gsize              length;
+    gulong             reached;
 
     g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
 
     priv = self->priv;
     g_return_val_if_fail (!priv->disposed, FALSE);
 
-    /* If we are in the last chunk and the current offset is equal
-     * to the upper limit, we are in the last valid position */
-    if (g_list_next (priv->current) == NULL && (priv->offset == priv->upper_limit))
+    /* All cells of a formerly fixed-size tape count as reached */
+    if (size == 0)
     {
-        check = TRUE;
+        priv->fixed = FALSE;
+
+        return TRUE;
     }
-    else
+
+    if (priv->fixed && priv->size == size)
     {
-        check = FALSE;
+        return TRUE;
     }
 
-    return check;
+    reached = ((priv->last - priv->first) >> priv->shift) + 1;
+
+    if (reached > size)
+    {
+        return FALSE;
+    }
+
+    if (size > (G_MAXULONG >> priv->shift))
+    {
+        g_error ("Tape size overflow");
+    }
+
+    /* The last cell ends up right before a guard page */
+    data = storage_new (size << priv->shift, &mapping, &length);
+    memcpy (data, priv->first, reached << priv->shift);
+
+    priv->origin -= (priv->first - priv->data) >> priv->shift;
+    priv->current = data + (priv->current - priv->first);
+
+    storage_free (priv->data, priv->mapping, priv->length);
+    priv->data = data;
+    priv->mapping = mapping;
+    priv->length = length;
+    priv->size = size;
+
+    priv->first = data;
+    priv->last = data + ((size - 1) << priv->shift);
+    priv->fixed = TRUE;
+
+    return TRUE;
 }
 
-/**
- * cattle_tape_push_bookmark:
- * @tape: a #CattleTape
+/* Change the width of the cells in @tape. The cells that have already
+ * been reached keep their values, truncated to the new width or
+ * sign-extended to it.
  *
- * Create a bookmark to the current tape position and save it on the
- * bookmark stack.
- */
+ * A fixed-size tape keeps its size in cells. Any other tape keeps its
+ * size in bytes instead, as long as the cells that have been reached
+ * still fit, so that wider cells don't make it reserve more memory.
+ *
+ * The values in the #CattleCellWidth enumeration are the base 2
+ * logarithm of the number of bytes in a cell */
 void
-cattle_tape_push_bookmark (CattleTape *self)
+cattle_tape_set_cell_width (CattleTape      *self,
+                            CattleCellWidth  width)
 {
-    CattleTapePrivate  *priv;
-    CattleTapeBookmark *bookmark;
+    CattleTapePrivate *priv;
+    gint8             *data;
+    gpointer           mapping;
+    gsize              length;
+    guint              shift;
+    gulong             size;
+    gulong             current;
+    gulong             first;
+    gulong             last;
+    gulong             start;
+    gulong             i;
 
     g_return_if_fail (CATTLE_IS_TAPE (self));
+    g_return_if_fail (width == CATTLE_CELL_WIDTH_8 ||
+                      width == CATTLE_CELL_WIDTH_16 ||
+                      width == CATTLE_CELL_WIDTH_32);
 
     priv = self->priv;
     g_return_if_fail (!priv->disposed);
 
-    /* Create a new bookmark and store the current position */
-    bookmark = g_new0 (CattleTapeBookmark, 1);
-    bookmark->chunk = priv->current;
-    bookmark->offset = priv->offset;
+    shift = width;
 
-    priv->bookmarks = g_slist_prepend (priv->bookmarks, bookmark);
-}
+    if (shift == priv->shift)
+    {
+        return;
+    }
 
-/**
- * cattle_tape_pop_bookmark:
- * @tape: a #CattleTape
- *
- * Restore the previously-saved tape position.
- * See cattle_tape_push_bookmark().
- *
- * Returns: %FALSE if the bookmarks stack is empty, %TRUE otherwise
- */
-gboolean
-cattle_tape_pop_bookmark (CattleTape *self)
-{
-    CattleTapePrivate  *priv;
-    CattleTapeBookmark *bookmark;
-    gboolean            check;
+    current = (priv->current - priv->data) >> priv->shift;
+    first = (priv->first - priv->data) >> priv->shift;
+    last = (priv->last - priv->data) >> priv->shift;
 
-    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+    /* The cells that have been reached are centered in the storage,
+     * unless the tape is fixed-size and they fill it completely */
+    size = priv->size;
+    start = first;
 
-    priv = self->priv;
-    g_return_val_if_fail (!priv->disposed, FALSE);
+    if (!priv->fixed)
+    {
+        size = MAX ((priv->size << priv->shift) >> shift, last - first + 1);
+        start = (size - (last - first + 1)) / 2;
+    }
 
-    if (priv->bookmarks != NULL) {
+    if (size > (G_MAXULONG >> shift))
+    {
+        g_error ("Tape size overflow");
+    }
 
-        /* Get the bookmark and remove it from the stack */
-        bookmark = priv->bookmarks->data;
-        priv->bookmarks = g_slist_remove (priv->bookmarks, bookmark);
+    data = storage_new (size << shift, &mapping, &length);
+
+    for (i = first; i <= last; i++)
+    {
+        cell_set (data + ((i - first + start) << shift),
+                  shift,
+                  cell_get (priv->data + (i << priv->shift), priv->shift));
+    }
+
+    storage_free (priv->data, priv->mapping, priv->length);
+    priv->data = data;
+    priv->mapping = mapping;
+    priv->length = length;
+    priv->size = size;
+    priv->shift = shift;
+    priv->origin = priv->origin - first + start;
+
+    priv->current = data + ((current - first + start) << shift);
+    priv->first = data + (start << shift);
+    priv->last = data + ((last - first + start) << shift);
+}
 
-        /* Restore the position */
-        priv->current = bookmark->chunk;
-        priv->offset = bookmark->offset;
+/* Get the number of cells spanned by each of the guard pages around
+ * the storage for @tape, which is zero if memory couldn't be mapped.
+ * A move that is no longer than that can't jump over a guard page */
+gulong
+cattle_tape_get_guard_size (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), 0);
 
-        /* Delete the bookmark */
-        g_free (bookmark);
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, 0);
+
+#ifdef HAVE_MMAP
+    if (priv->mapping != NULL)
+    {
+        return ((gulong) sysconf (_SC_PAGESIZE)) >> priv->shift;
+    }
+#endif
+
+    return 0;
+}
+
+/* Check whether @tape can be moved @steps cells to the left, which is
+ * always the case unless it's fixed-size */
+gboolean
+cattle_tape_can_move_left (CattleTape *self,
+                           gulong      steps)
+{
+    CattleTapePrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, FALSE);
+
+    return (!priv->fixed ||
+            steps <= (gulong) ((priv->current - priv->first) >> priv->shift));
+}
+
+/* Check whether @tape can be moved @steps cells to the right. See
+ * cattle_tape_can_move_left() */
+gboolean
+cattle_tape_can_move_right (CattleTape *self,
+                            gulong      steps)
+{
+    CattleTapePrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, FALSE);
+
+    return (!priv->fixed ||
+            steps <= (gulong) ((priv->last - priv->current) >> priv->shift));
+}
+
+/* Move from @cell @stride cells to the left at a time until a cell
+ * containing zero is found, or until the next step would go past
+ * @first, and return the last cell that has been checked.
+ *
+ * Cells are 1 << @shift bytes wide: callers pass a constant, so that
+ * the compiler can generate a specialized loop for each width */
+static inline gint8*
+find_zero_left (gint8  *cell,
+                gint8  *first,
+                gulong  stride,
+                guint   shift)
+{
+    while (cell_get (cell, shift) != 0 &&
+           (gulong) ((cell - first) >> shift) >= stride)
+    {
+        cell -= stride << shift;
+    }
+
+    return cell;
+}
+
+/* Same as find_zero_left(), but moving to the right, up to @last */
+static inline gint8*
+find_zero_right (gint8  *cell,
+                 gint8  *last,
+                 gulong  stride,
+                 guint   shift)
+{
+    while (cell_get (cell, shift) != 0 &&
+           (gulong) ((last - cell) >> shift) >= stride)
+    {
+        cell += stride << shift;
+    }
+
+    return cell;
+}
+
+/* Move @stride cells to the left at a time until a cell containing
+ * zero is found, starting from the current one.
+ *
+ * There's no portable equivalent of memchr() that searches backwards,
+ * so cells are checked one at a time using a tight loop. Cells that
+ * have not been reached yet contain zero, so the search can stop
+ * right before the first one.
+ *
+ * Returns FALSE if the search would go past the first cell of a
+ * fixed-size tape, in which case the tape is left on the last cell
+ * that has been checked */
+gboolean
+cattle_tape_scan_left (CattleTape *self,
+                       gulong      stride)
+{
+    CattleTapePrivate *priv;
+    gint8             *cell;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+    g_return_val_if_fail (stride > 0, FALSE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, FALSE);
+
+    switch (priv->shift)
+    {
+        case 1:
+            cell = find_zero_left (priv->current, priv->first, stride, 1);
+            break;
+        case 2:
+            cell = find_zero_left (priv->current, priv->first, stride, 2);
+            break;
+        default:
+            cell = find_zero_left (priv->current, priv->first, stride, 0);
+            break;
+    }
+
+    priv->current = cell;
+
+    if (cell_get (cell, priv->shift) != 0)
+    {
+        if (priv->fixed)
+        {
+            return FALSE;
+        }
+
+        /* Go past the first cell */
+        cattle_tape_move_left_by (self, stride);
+    }
+
+    return TRUE;
+}
+
+/* Move @stride cells to the right at a time until a cell containing
+ * zero is found, starting from the current one. See
+ * cattle_tape_scan_left() */
+gboolean
+cattle_tape_scan_right (CattleTape *self,
+                        gulong      stride)
+{
+    CattleTapePrivate *priv;
+    gint8             *cell;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+    g_return_val_if_fail (stride > 0, FALSE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, FALSE);
+
+    cell = priv->current;
+
+    if (stride == 1 && priv->shift == 0)
+    {
+        cell = memchr (cell, 0, priv->last - cell + 1);
+
+        if (cell != NULL)
+        {
+            priv->current = cell;
+
+            return TRUE;
+        }
+
+        cell = priv->last;
+    }
+
+    switch (priv->shift)
+    {
+        case 1:
+            cell = find_zero_right (cell, priv->last, stride, 1);
+            break;
+        case 2:
+            cell = find_zero_right (cell, priv->last, stride, 2);
+            break;
+        default:
+            cell = find_zero_right (cell, priv->last, stride, 0);
+            break;
+    }
+
+    priv->current = cell;
+
+    if (cell_get (cell, priv->shift) != 0)
+    {
+        if (priv->fixed)
+        {
+            return FALSE;
+        }
+
+        /* Go past the last cell */
+        cattle_tape_move_right_by (self, stride);
+    }
+
+    return TRUE;
+}
+
+/**
+ * cattle_tape_is_at_beginning:
+ * @tape: a #CattleTape
+ *
+ * Check if the current cell is the first one of @tape.
+ *
+ * Since the tape grows automatically as more cells are needed, it is
+ * possible to move left from the first cell, unless the tape has a
+ * fixed size.
+ *
+ * Returns: %TRUE if the current cell is the first one, %FALSE otherwise
+ */
+gboolean
+cattle_tape_is_at_beginning (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+    gboolean           check;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, FALSE);
+
+    /* If the current cell is the first one that has been reached,
+     * we are at the beginning of the tape */
+    if (priv->current == priv->first)
+    {
+        check = TRUE;
+    }
+    else
+    {
+        check = FALSE;
+    }
+
+    return check;
+}
+
+/**
+ * cattle_tape_is_at_end:
+ * @tape: a #CattleTape
+ *
+ * Check if the current cell is the last one of @tape.
+ * 
+ * Since the tape grows automatically as more cells are needed, it is
+ * possible to move right from the last cell, unless the tape has a
+ * fixed size.
+ *
+ * Returns: %TRUE if the current cell is the last one, %FALSE otherwise
+ */
+gboolean
+cattle_tape_is_at_end (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+    gboolean           check;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, FALSE);
+
+    /* If the current cell is the last one that has been reached,
+     * we are in the last valid position */
+    if (priv->current == priv->last)
+    {
+        check = TRUE;
+    }
+    else
+    {
+        check = FALSE;
+    }
+
+    return check;
+}
+
+/**
+ * cattle_tape_get_length:
+ * @tape: a #CattleTape
+ *
+ * Get the number of cells between the beginning and the end of @tape,
+ * both included. See cattle_tape_is_at_beginning() and
+ * cattle_tape_is_at_end().
+ *
+ * Returns: the length of @tape
+ */
+gulong
+cattle_tape_get_length (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), 0);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, 0);
+
+    return ((priv->last - priv->first) >> priv->shift) + 1;
+}
+
+/**
+ * cattle_tape_get_position:
+ * @tape: a #CattleTape
+ *
+ * Get the position of the current cell, counting from the beginning
+ * of @tape, which is at position zero.
+ *
+ * Since the tape grows on the left when moving past its beginning,
+ * the position of a cell can change over time.
+ *
+ * Returns: the position of the current cell
+ */
+gulong
+cattle_tape_get_position (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), 0);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, 0);
+
+    return (priv->current - priv->first) >> priv->shift;
+}
+
+/**
+ * cattle_tape_get_values:
+ * @tape: a #CattleTape
+ * @start: position of the first cell
+ * @count: number of cells
+ * @values: (out caller-allocates) (array length=count): return location
+ * for the values
+ *
+ * Copy the values of @count cells, starting from the one at position
+ * @start, into @values. Positions are counted from the beginning of
+ * @tape, see cattle_tape_get_position(), and all cells must be between
+ * the beginning and the end of @tape.
+ *
+ * Just like for cattle_tape_get_current_value(), only the lowest 8
+ * bits of each value are returned if cells are wider than that.
+ */
+void
+cattle_tape_get_values (CattleTape *self,
+                        gulong      start,
+                        gulong      count,
+                        gint8      *values)
+{
+    CattleTapePrivate *priv;
+    gint8             *cell;
+    gulong             length;
+    gulong             i;
+
+    g_return_if_fail (CATTLE_IS_TAPE (self));
+    g_return_if_fail (values != NULL || count == 0);
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    length = ((priv->last - priv->first) >> priv->shift) + 1;
+    g_return_if_fail (start <= length && count <= length - start);
+
+    cell = priv->first + (start << priv->shift);
+
+    if (priv->shift == 0)
+    {
+        memcpy (values, cell, count);
+
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        values[i] = (gint8) cell_get (cell + (i << priv->shift), priv->shift);
+    }
+}
+
+/**
+ * cattle_tape_set_values:
+ * @tape: a #CattleTape
+ * @start: position of the first cell
+ * @count: number of cells
+ * @values: (array length=count): the new values
+ *
+ * Copy @count values from @values into the cells starting from the one
+ * at position @start. See cattle_tape_get_values().
+ *
+ * The cells must start between the beginning and the end of @tape, but
+ * they can go past its end, in which case @tape grows to make room for
+ * them, unless it has a fixed size. The current cell pointer is not
+ * moved.
+ *
+ * Just like for cattle_tape_set_current_value(), values are
+ * sign-extended if cells are wider than 8 bits.
+ */
+void
+cattle_tape_set_values (CattleTape  *self,
+                        gulong       start,
+                        gulong       count,
+                        const gint8 *values)
+{
+    CattleTapePrivate *priv;
+    gint8             *cell;
+    gulong             length;
+    gulong             position;
+    gulong             i;
+
+    g_return_if_fail (CATTLE_IS_TAPE (self));
+    g_return_if_fail (values != NULL || count == 0);
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    length = ((priv->last - priv->first) >> priv->shift) + 1;
+    g_return_if_fail (start <= length && count <= G_MAXULONG - start);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    /* Grow the tape to include the last cell */
+    if (start + count > length)
+    {
+        g_return_if_fail (!priv->fixed);
+
+        position = (priv->current - priv->first) >> priv->shift;
+        reserve (priv, 0, start + count - 1 - position);
+
+        priv->last = priv->first + ((start + count - 1) << priv->shift);
+    }
+
+    cell = priv->first + (start << priv->shift);
+
+    if (priv->shift == 0)
+    {
+        memcpy (cell, values, count);
+
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        cell_set (cell + (i << priv->shift), priv->shift, values[i]);
+    }
+}
+
+/**
+ * cattle_tape_peek_values:
+ * @tape: a #CattleTape
+ * @start: position of the first cell
+ * @count: number of cells
+ *
+ * Get direct access to the values of @count cells, starting from the
+ * one at position @start, without copying them. See
+ * cattle_tape_get_values().
+ *
+ * The returned memory is owned by @tape and can't be modified. It is
+ * only valid until @tape is modified or moved in any way, or a program
+ * is run on it.
+ *
+ * This is only possible if cells are 8 bits wide: for wider cells,
+ * use cattle_tape_get_values() instead.
+ *
+ * Returns: (transfer none) (array length=count) (nullable): the values,
+ * or %NULL if cells are wider than 8 bits
+ */
+const gint8*
+cattle_tape_peek_values (CattleTape *self,
+                         gulong      start,
+                         gulong      count)
+{
+    CattleTapePrivate *priv;
+    gulong             length;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), NULL);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, NULL);
+
+    length = ((priv->last - priv->first) >> priv->shift) + 1;
+    g_return_val_if_fail (start <= length && count <= length - start, NULL);
+
+    if (priv->shift != 0)
+    {
+        return NULL;
+    }
+
+    return priv->first + start;
+}
+
+/**
+ * cattle_tape_clear:
+ * @tape: a #CattleTape
+ *
+ * Set all cells in @tape to zero, move back to the initial position
+ * and remove all bookmarks, so that @tape can be reused as if it had
+ * just been created. Positions saved using cattle_tape_save_position()
+ * can't be restored anymore.
+ *
+ * Only the cells that have been reached are cleared, and the memory
+ * already allocated is kept: this is much faster than replacing @tape
+ * with a new one, especially when it's used to run short programs
+ * over and over.
+ *
+ * If @tape has a fixed size, it's kept, and its first cell becomes the
+ * current one.
+ */
+void
+cattle_tape_clear (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_TAPE (self));
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    /* All cells outside of the reached range are still zero */
+    memset (priv->first, 0, (priv->last - priv->first) + (1 << priv->shift));
+
+    g_array_set_size (priv->bookmarks, 0);
+
+    if (priv->fixed)
+    {
+        priv->origin = 0;
+        priv->current = priv->first;
+
+        return;
+    }
+
+    /* Start in the middle again */
+    priv->origin = priv->size / 2;
+
+    priv->current = priv->data + (priv->origin << priv->shift);
+    priv->first = priv->current;
+    priv->last = priv->current;
+}
+
+/**
+ * cattle_tape_save_position:
+ * @tape: a #CattleTape
+ * @position: (out caller-allocates): return location for the position
+ *
+ * Save the current position of @tape into @position, which can later
+ * be passed to cattle_tape_restore_position().
+ *
+ * Unlike bookmarks, positions are plain values that can be stored
+ * anywhere, restored any number of times and in any order, and don't
+ * need to be released.
+ */
+void
+cattle_tape_save_position (CattleTape         *self,
+                           CattleTapePosition *position)
+{
+    CattleTapePrivate *priv;
+
+    g_return_if_fail (CATTLE_IS_TAPE (self));
+    g_return_if_fail (position != NULL);
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    /* The position is relative to the origin, which doesn't change
+     * when the storage grows */
+    position->offset = ((priv->current - priv->data) >> priv->shift) -
+                       (glong) priv->origin;
+}
+
+/**
+ * cattle_tape_restore_position:
+ * @tape: a #CattleTape
+ * @position: a position saved using cattle_tape_save_position()
+ *
+ * Make the cell @position refers to the current one.
+ *
+ * @position must have been saved from @tape, and not before the last
+ * call to cattle_tape_clear().
+ */
+void
+cattle_tape_restore_position (CattleTape               *self,
+                              const CattleTapePosition *position)
+{
+    CattleTapePrivate *priv;
+    glong              first;
+    glong              last;
+
+    g_return_if_fail (CATTLE_IS_TAPE (self));
+    g_return_if_fail (position != NULL);
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    /* All cells between the first and the last one reached are still
+     * there, even though the storage might have grown in the
+     * meantime */
+    first = ((priv->first - priv->data) >> priv->shift) - (glong) priv->origin;
+    last = ((priv->last - priv->data) >> priv->shift) - (glong) priv->origin;
+    g_return_if_fail (position->offset >= first && position->offset <= last);
+
+    priv->current = priv->data +
+                    ((priv->origin + position->offset) << priv->shift);
+}
+
+/**
+ * cattle_tape_push_bookmark:
+ * @tape: a #CattleTape
+ *
+ * Create a bookmark to the current tape position and save it on the
+ * bookmark stack.
+ *
+ * cattle_tape_save_position() is cheaper, and should be preferred if
+ * the position can be stored by the caller.
+ */
+void
+cattle_tape_push_bookmark (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+    glong              position;
+
+    g_return_if_fail (CATTLE_IS_TAPE (self));
+
+    priv = self->priv;
+    g_return_if_fail (!priv->disposed);
+
+    /* Store the current position on top of the stack */
+    position = ((priv->current - priv->data) >> priv->shift) -
+               (glong) priv->origin;
+
+    g_array_append_val (priv->bookmarks, position);
+}
+
+/**
+ * cattle_tape_pop_bookmark:
+ * @tape: a #CattleTape
+ *
+ * Restore the previously-saved tape position.
+ * See cattle_tape_push_bookmark().
+ *
+ * Returns: %FALSE if the bookmarks stack is empty, %TRUE otherwise
+ */
+gboolean
+cattle_tape_pop_bookmark (CattleTape *self)
+{
+    CattleTapePrivate *priv;
+    glong              position;
+    gboolean           check;
+
+    g_return_val_if_fail (CATTLE_IS_TAPE (self), FALSE);
+
+    priv = self->priv;
+    g_return_val_if_fail (!priv->disposed, FALSE);
+
+    if (priv->bookmarks->len > 0) {
+
+        /* Get the bookmark and remove it from the stack */
+        position = g_array_index (priv->bookmarks,
+                                  glong,
+                                  priv->bookmarks->len - 1);
+        g_array_set_size (priv->bookmarks, priv->bookmarks->len - 1);
+
+        /* Restore the position. The storage might have grown in the
+         * meantime, but all cells between the first and the last
+         * one reached are still there */
+        priv->current = priv->data +
+                        ((priv->origin + position) << priv->shift);
 
         check = TRUE;
     }
@@ -36,9 +36,10 @@ G_BEGIN_DECLS
 #define CATTLE_IS_TAPE_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), CATTLE_TYPE_TAPE))
 #define CATTLE_TAPE_GET_CLASS(object) (G_TYPE_INSTANCE_GET_CLASS ((object), CATTLE_TYPE_TAPE, CattleTapeClass))
 
-typedef struct _CattleTape        CattleTape;
-typedef struct _CattleTapeClass   CattleTapeClass;
-typedef struct _CattleTapePrivate CattleTapePrivate;
+typedef struct _CattleTape         CattleTape;
+typedef struct _CattleTapeClass    CattleTapeClass;
+typedef struct _CattleTapePrivate  CattleTapePrivate;
+typedef struct _CattleTapePosition CattleTapePosition;
 
 struct _CattleTape
 {
@@ -51,28 +52,55 @@ struct _CattleTapeClass
     GObjectClass parent;
 };
 
-CattleTape* cattle_tape_new                       (void);
-void        cattle_tape_set_current_value         (CattleTape *tape,
-                                                   gint8       value);
-gint8       cattle_tape_get_current_value         (CattleTape *tape);
-void        cattle_tape_increase_current_value    (CattleTape *tape);
-void        cattle_tape_increase_current_value_by (CattleTape *tape,
-                                                   gulong      value);
-void        cattle_tape_decrease_current_value    (CattleTape *tape);
-void        cattle_tape_decrease_current_value_by (CattleTape *tape,
-                                                   gulong      value);
-void        cattle_tape_move_left                 (CattleTape *tape);
-void        cattle_tape_move_left_by              (CattleTape *tape,
-                                                   gulong      steps);
-void        cattle_tape_move_right                (CattleTape *tape);
-void        cattle_tape_move_right_by             (CattleTape *tape,
-                                                   gulong      steps);
-gboolean    cattle_tape_is_at_beginning           (CattleTape *tape);
-gboolean    cattle_tape_is_at_end                 (CattleTape *tape);
-void        cattle_tape_push_bookmark             (CattleTape *tape);
-gboolean    cattle_tape_pop_bookmark              (CattleTape *tape);
+struct _CattleTapePosition
+{
+    /*< private >*/
+    glong offset;
+};
+
+CattleTape*  cattle_tape_new                       (void);
+void         cattle_tape_set_current_value         (CattleTape               *tape,
+                                                    gint8                     value);
+gint8        cattle_tape_get_current_value         (CattleTape               *tape);
+void         cattle_tape_set_current_wide_value    (CattleTape               *tape,
+                                                    gint32                    value);
+gint32       cattle_tape_get_current_wide_value    (CattleTape               *tape);
+void         cattle_tape_increase_current_value    (CattleTape               *tape);
+void         cattle_tape_increase_current_value_by (CattleTape               *tape,
+                                                    gulong                    value);
+void         cattle_tape_decrease_current_value    (CattleTape               *tape);
+void         cattle_tape_decrease_current_value_by (CattleTape               *tape,
+                                                    gulong                    value);
+void         cattle_tape_move_left                 (CattleTape               *tape);
+void         cattle_tape_move_left_by              (CattleTape               *tape,
+                                                    gulong                    steps);
+void         cattle_tape_move_right                (CattleTape               *tape);
+void         cattle_tape_move_right_by             (CattleTape               *tape,
+                                                    gulong                    steps);
+gboolean     cattle_tape_is_at_beginning           (CattleTape               *tape);
+gboolean     cattle_tape_is_at_end                 (CattleTape               *tape);
+gulong       cattle_tape_get_length                (CattleTape               *tape);
+gulong       cattle_tape_get_position              (CattleTape               *tape);
+void         cattle_tape_get_values                (CattleTape               *tape,
+                                                    gulong                    start,
+                                                    gulong                    count,
+                                                    gint8                    *values);
+void         cattle_tape_set_values                (CattleTape               *tape,
+                                                    gulong                    start,
+                                                    gulong                    count,
+                                                    const gint8              *values);
+const gint8* cattle_tape_peek_values               (CattleTape               *tape,
+                                                    gulong                    start,
+                                                    gulong                    count);
+void         cattle_tape_clear                     (CattleTape               *tape);
+void         cattle_tape_save_position             (CattleTape               *tape,
+                                                    CattleTapePosition       *position);
+void         cattle_tape_restore_position          (CattleTape               *tape,
+                                                    const CattleTapePosition *position);
+void         cattle_tape_push_bookmark             (CattleTape               *tape);
+gboolean     cattle_tape_pop_bookmark              (CattleTape               *tape);
 
-GType       cattle_tape_get_type                  (void) G_GNUC_CONST;
+GType        cattle_tape_get_type                  (void) G_GNUC_CONST;
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (CattleTape, g_object_unref)
 
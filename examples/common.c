@@ -18,35 +18,29 @@
  * Homepage: https://kiyuko.org/software/cattle
  */
 
-#include <gio/gio.h>
 #include "common.h"
 
 CattleBuffer*
 read_file_contents (const gchar  *path,
                     GError      **error)
 {
-    CattleBuffer      *buffer;
-    g_autoptr (GFile)  file = NULL;
-    g_autofree gchar  *contents = NULL;
-    GError            *inner_error;
-    gint8             *start;
-    gsize              length;
-    gboolean           success;
+    g_autoptr (GMappedFile) file = NULL;
+    g_autoptr (GBytes)      contents = NULL;
+    g_autoptr (GBytes)      program = NULL;
+    GError                 *inner_error;
+    const gchar            *start;
+    gsize                   offset;
+    gsize                   length;
 
     g_return_val_if_fail (path != NULL, NULL);
     g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-    file = g_file_new_for_commandline_arg (path);
-
+    /* Map the file rather than reading it, so that even very large
+     * programs are never copied around */
     inner_error = NULL;
-    success = g_file_load_contents (file,
-                                    NULL,
-                                    &contents,
-                                    &length,
-                                    NULL,
-                                    &inner_error);
+    file = g_mapped_file_new (path, FALSE, &inner_error);
 
-    if (!success)
+    if (file == NULL)
     {
         g_propagate_error (error,
                            inner_error);
@@ -54,24 +48,20 @@ read_file_contents (const gchar  *path,
         return NULL;
     }
 
-    start = (gint8 *) contents;
+    contents = g_mapped_file_get_bytes (file);
+    start = g_bytes_get_data (contents, &length);
+    offset = 0;
 
     /* Skip the sha-bang line if present */
-    if (length >= 2 && contents[0] == '#' && contents[1] == '!')
+    if (length >= 2 && start[0] == '#' && start[1] == '!')
     {
-        while (length > 0 && start[0] != '\n')
+        while (offset < length && start[offset] != '\n')
         {
-            start++;
-            length--;
+            offset++;
         }
     }
 
-    buffer = cattle_buffer_new (length);
-
-    if (length > 0)
-    {
-        cattle_buffer_set_contents (buffer, start);
-    }
+    program = g_bytes_new_from_bytes (contents, offset, length - offset);
 
-    return buffer;
+    return cattle_buffer_new_from_bytes (program);
 }
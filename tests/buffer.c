@@ -20,7 +20,10 @@
 
 #include <glib.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <cattle/cattle.h>
+#include <string.h>
+#include <unistd.h>
 
 /**
  * test_buffer_empty:
@@ -145,6 +148,138 @@ test_buffer_set_value (void)
     }
 }
 
+/**
+ * test_buffer_get_contents:
+ *
+ * Ensure the contents of a buffer can be retrieved all at once, either
+ * by copying them or by accessing them directly.
+ */
+void
+test_buffer_get_contents (void)
+{
+    g_autoptr (CattleBuffer) buffer = NULL;
+    g_autoptr (CattleBuffer) empty = NULL;
+    const gint8             *data;
+    gint8                    values[4];
+
+    buffer = cattle_buffer_new (4);
+    cattle_buffer_set_contents (buffer, (gint8 *) "abcd");
+
+    memset (values, 0, 4);
+    cattle_buffer_get_contents (buffer, values);
+    g_assert (memcmp (values, "abcd", 4) == 0);
+
+    /* Only copy part of the contents */
+    memset (values, 0, 4);
+    cattle_buffer_get_contents_full (buffer, values, 2);
+    g_assert (memcmp (values, "ab\0\0", 4) == 0);
+
+    data = cattle_buffer_peek_contents (buffer);
+    g_assert (data != NULL);
+    g_assert (memcmp (data, "abcd", 4) == 0);
+
+    /* Changes are visible through the pointer */
+    cattle_buffer_set_value (buffer, 3, 'x');
+    g_assert (data[3] == 'x');
+
+    empty = cattle_buffer_new (0);
+    g_assert (cattle_buffer_peek_contents (empty) == NULL);
+}
+
+/**
+ * test_buffer_from_bytes:
+ *
+ * Ensure a buffer can wrap existing data without copying it.
+ */
+void
+test_buffer_from_bytes (void)
+{
+    g_autoptr (CattleBuffer) buffer = NULL;
+    g_autoptr (GBytes)       bytes = NULL;
+
+    bytes = g_bytes_new_static ("abc", 3);
+
+    buffer = cattle_buffer_new_from_bytes (bytes);
+    g_assert (cattle_buffer_get_size (buffer) == 3);
+
+    g_assert (cattle_buffer_get_value (buffer, 0) == 'a');
+    g_assert (cattle_buffer_get_value (buffer, 1) == 'b');
+    g_assert (cattle_buffer_get_value (buffer, 2) == 'c');
+}
+
+/**
+ * test_buffer_from_file:
+ *
+ * Ensure a buffer can be created from the contents of a file, and
+ * that errors are reported correctly.
+ */
+void
+test_buffer_from_file (void)
+{
+    g_autoptr (CattleBuffer) buffer = NULL;
+    g_autoptr (GError)       error = NULL;
+    g_autofree gchar        *path = NULL;
+    gint                     fd;
+
+    fd = g_file_open_tmp ("cattle-buffer-XXXXXX", &path, NULL);
+    g_assert (fd >= 0);
+    close (fd);
+
+    g_assert (g_file_set_contents (path, "+[-]", 4, NULL));
+
+    buffer = cattle_buffer_new_from_file (path, NULL);
+    g_assert (buffer != NULL);
+    g_assert (cattle_buffer_get_size (buffer) == 4);
+    g_assert (cattle_buffer_get_value (buffer, 0) == '+');
+    g_assert (cattle_buffer_get_value (buffer, 3) == ']');
+
+    g_unlink (path);
+
+    /* The buffer is still usable after the file has been removed */
+    g_assert (cattle_buffer_get_value (buffer, 1) == '[');
+    g_clear_object (&buffer);
+
+    buffer = cattle_buffer_new_from_file (path, &error);
+    g_assert (buffer == NULL);
+    g_assert (error != NULL);
+}
+
+/**
+ * test_buffer_slice:
+ *
+ * Ensure a slice shares its contents with the buffer it's been created
+ * from, and that slices of slices work as well.
+ */
+void
+test_buffer_slice (void)
+{
+    g_autoptr (CattleBuffer) buffer = NULL;
+    g_autoptr (CattleBuffer) slice = NULL;
+    g_autoptr (CattleBuffer) inner = NULL;
+
+    buffer = cattle_buffer_new (5);
+    cattle_buffer_set_contents (buffer, (gint8 *) "abcde");
+
+    slice = cattle_buffer_new_slice (buffer, 1, 3);
+    g_assert (cattle_buffer_get_size (slice) == 3);
+    g_assert (cattle_buffer_get_value (slice, 0) == 'b');
+    g_assert (cattle_buffer_get_value (slice, 2) == 'd');
+
+    inner = cattle_buffer_new_slice (slice, 1, 2);
+    g_assert (cattle_buffer_get_size (inner) == 2);
+    g_assert (cattle_buffer_get_value (inner, 0) == 'c');
+
+    /* Changes are visible through all of them */
+    cattle_buffer_set_value (inner, 0, 'x');
+    g_assert (cattle_buffer_get_value (slice, 1) == 'x');
+    g_assert (cattle_buffer_get_value (buffer, 2) == 'x');
+
+    /* Slices keep the storage alive */
+    g_clear_object (&buffer);
+    g_clear_object (&slice);
+    g_assert (cattle_buffer_get_value (inner, 1) == 'd');
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -162,6 +297,14 @@ main (gint argc, gchar **argv)
                      test_buffer_set_contents_string);
     g_test_add_func ("/buffer/set-value",
                      test_buffer_set_value);
+    g_test_add_func ("/buffer/get-contents",
+                     test_buffer_get_contents);
+    g_test_add_func ("/buffer/from-bytes",
+                     test_buffer_from_bytes);
+    g_test_add_func ("/buffer/from-file",
+                     test_buffer_from_file);
+    g_test_add_func ("/buffer/slice",
+                     test_buffer_slice);
 
     return g_test_run ();
 }
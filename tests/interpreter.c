@@ -22,6 +22,7 @@
 #include <glib-object.h>
 #include <cattle/cattle.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* Succesful input handler */
 static gboolean
@@ -118,6 +119,39 @@ input_fail_only_error (CattleInterpreter  *interpreter G_GNUC_UNUSED,
     return TRUE;
 }
 
+/* Input handed out in chunks by a bulk input handler */
+typedef struct
+{
+    const gchar *contents;
+    gulong       offset;
+    gulong       size;
+    guint        calls;
+} BulkInput;
+
+/* Succesful bulk input handler that returns as much input as it can
+ * fit in the buffer each time */
+static gboolean
+bulk_input_success (CattleInterpreter  *interpreter G_GNUC_UNUSED,
+                    gint8              *buffer,
+                    gulong              size,
+                    gulong             *length,
+                    gpointer            data,
+                    GError            **error G_GNUC_UNUSED)
+{
+    BulkInput *bulk;
+
+    bulk = (BulkInput*) data;
+
+    *length = MIN (size, strlen (bulk->contents) - bulk->offset);
+    memcpy (buffer, bulk->contents + bulk->offset, *length);
+
+    bulk->offset += *length;
+    bulk->size = size;
+    bulk->calls++;
+
+    return TRUE;
+}
+
 /* Succesfull output handler working on a buffer */
 static gboolean
 output_success_buffer (CattleInterpreter  *interpreter G_GNUC_UNUSED,
@@ -175,6 +209,50 @@ output_fail_only_error (CattleInterpreter  *interpreter G_GNUC_UNUSED,
     return TRUE;
 }
 
+/* Output collected by a bulk output handler */
+typedef struct
+{
+    GString *buffer;
+    guint    calls;
+} BulkOutput;
+
+/* Succesful bulk output handler working on a buffer, which also
+ * counts how many times it has been invoked */
+static gboolean
+bulk_output_success_buffer (CattleInterpreter  *interpreter G_GNUC_UNUSED,
+                            const gint8        *output,
+                            gulong              size,
+                            gpointer            data,
+                            GError            **error G_GNUC_UNUSED)
+{
+    BulkOutput *bulk;
+
+    bulk = (BulkOutput*) data;
+
+    g_string_append_len (bulk->buffer,
+                         (const gchar *) output,
+                         size);
+    bulk->calls++;
+
+    return TRUE;
+}
+
+/* Unsuccesful bulk output handler that sets the error */
+static gboolean
+bulk_output_fail_set_error (CattleInterpreter  *interpreter G_GNUC_UNUSED,
+                            const gint8        *output G_GNUC_UNUSED,
+                            gulong              size G_GNUC_UNUSED,
+                            gpointer            data G_GNUC_UNUSED,
+                            GError            **error)
+{
+    g_set_error_literal (error,
+                         CATTLE_ERROR,
+                         CATTLE_ERROR_IO,
+                         "Spurious error");
+
+    return FALSE;
+}
+
 /* Succesfut debug handler working on a buffer */
 static gboolean
 debug_success_buffer (CattleInterpreter  *interpreter G_GNUC_UNUSED,
@@ -270,6 +348,145 @@ test_interpreter_handlers (void)
     g_assert (g_utf8_collate (output->str, "w0h") == 0);
 }
 
+/**
+ * test_interpreter_bulk_input:
+ *
+ * Make sure a bulk input handler is asked for input until it runs
+ * out, and is passed a buffer of the configured size.
+ */
+static void
+test_interpreter_bulk_input (void)
+{
+    g_autoptr (CattleInterpreter)   interpreter = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    g_autoptr (CattleProgram)       program = NULL;
+    g_autoptr (CattleBuffer)        buffer = NULL;
+    g_autoptr (GError)              error = NULL;
+    g_autoptr (GString)             output = NULL;
+    BulkInput                       bulk;
+    gboolean                        success;
+
+    interpreter = cattle_interpreter_new ();
+
+    configuration = cattle_interpreter_get_configuration (interpreter);
+    cattle_configuration_set_input_buffer_size (configuration, 3);
+
+    /* Echo all input */
+    buffer = cattle_buffer_new (5);
+    cattle_buffer_set_contents (buffer, (gint8 *) ",[.,]");
+
+    program = cattle_interpreter_get_program (interpreter);
+    cattle_program_load (program, buffer, NULL);
+
+    output = g_string_new ("");
+    bulk.contents = "whatever";
+    bulk.offset = 0;
+    bulk.size = 0;
+    bulk.calls = 0;
+
+    cattle_interpreter_set_bulk_input_handler (interpreter,
+                                               bulk_input_success,
+                                               &bulk);
+    cattle_interpreter_set_output_handler (interpreter,
+                                           output_success_buffer,
+                                           output);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (success);
+    g_assert (g_utf8_collate (output->str, "whatever") == 0);
+    g_assert (bulk.size == 3);
+
+    /* Three chunks of input, and a last call to find out the end of
+     * input has been reached */
+    g_assert (bulk.calls == 4);
+}
+
+#define BULK_OUTPUT_SIZE 10000
+
+/**
+ * test_interpreter_bulk_output:
+ *
+ * Make sure a bulk output handler gets all output, in order with
+ * respect to input and debug actions, and is not invoked once for
+ * each value.
+ */
+static void
+test_interpreter_bulk_output (void)
+{
+    g_autoptr (CattleInterpreter)   interpreter = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    g_autoptr (CattleProgram)       program = NULL;
+    g_autoptr (CattleTape)          tape = NULL;
+    g_autoptr (CattleBuffer)        buffer = NULL;
+    g_autoptr (GError)              error1 = NULL;
+    g_autoptr (GError)              error2 = NULL;
+    g_autoptr (GString)             output = NULL;
+    g_autofree gchar               *contents = NULL;
+    BulkOutput                      bulk;
+    gboolean                        success;
+
+    interpreter = cattle_interpreter_new ();
+
+    configuration = cattle_interpreter_get_configuration (interpreter);
+    cattle_configuration_set_debug_is_enabled (configuration, TRUE);
+
+    /* Output is flushed before input and debug actions */
+    buffer = cattle_buffer_new (5);
+    cattle_buffer_set_contents (buffer, (gint8 *) ",.,#.");
+
+    program = cattle_interpreter_get_program (interpreter);
+    cattle_program_load (program, buffer, NULL);
+
+    output = g_string_new ("");
+    bulk.buffer = output;
+    bulk.calls = 0;
+
+    cattle_interpreter_set_input_handler (interpreter,
+                                          input_success,
+                                          NULL);
+    cattle_interpreter_set_bulk_output_handler (interpreter,
+                                                bulk_output_success_buffer,
+                                                &bulk);
+    cattle_interpreter_set_debug_handler (interpreter,
+                                          debug_success_buffer,
+                                          output);
+
+    success = cattle_interpreter_run (interpreter, &error1);
+    g_assert (success);
+    g_assert (g_utf8_collate (output->str, "w0h") == 0);
+    g_assert (bulk.calls == 2);
+
+    /* A lot of output is passed to the handler in a few large chunks */
+    g_object_unref (buffer);
+    contents = g_strnfill (BULK_OUTPUT_SIZE, '.');
+    contents[0] = '+';
+    buffer = cattle_buffer_new (BULK_OUTPUT_SIZE);
+    cattle_buffer_set_contents (buffer, (gint8 *) contents);
+
+    cattle_program_load (program, buffer, NULL);
+
+    tape = cattle_interpreter_get_tape (interpreter);
+    cattle_tape_clear (tape);
+
+    g_string_truncate (output, 0);
+    bulk.calls = 0;
+
+    success = cattle_interpreter_run (interpreter, NULL);
+    g_assert (success);
+    g_assert (output->len == BULK_OUTPUT_SIZE - 1);
+    g_assert (strspn (output->str, "\x01") == BULK_OUTPUT_SIZE - 1);
+    g_assert (bulk.calls > 0 && bulk.calls < 10);
+
+    /* Errors raised while flushing at the end of a run are reported */
+    cattle_interpreter_set_bulk_output_handler (interpreter,
+                                                bulk_output_fail_set_error,
+                                                NULL);
+
+    success = cattle_interpreter_run (interpreter, &error2);
+    g_assert (!success);
+    g_assert (g_error_matches (error2, CATTLE_ERROR, CATTLE_ERROR_IO));
+}
+
 /**
  * test_interpreter_failed_input:
  *
@@ -579,23 +796,952 @@ test_interpreter_unbalanced_brackets (void)
     g_assert (g_error_matches (error1, CATTLE_ERROR, CATTLE_ERROR_UNBALANCED_BRACKETS));
 
     /* Now make the start of loop instruction an end of loop instruction:
-     * the program is now ]+++ */
+     * the program is now ]+++. Set the instructions again so that the
+     * program picks up the change */
     cattle_instruction_set_value (instructions,
                                   CATTLE_INSTRUCTION_LOOP_END);
+    cattle_program_set_instructions (program, instructions);
 
     success = cattle_interpreter_run (interpreter, &error2);
     g_assert (!success);
     g_assert (g_error_matches (error2, CATTLE_ERROR, CATTLE_ERROR_UNBALANCED_BRACKETS));
 }
 
+#define PROGRAM_HELLO_WORLD "++++++++[>++++[>++>+++>+++>+<<<<-]>+>+>->>+[<]<-]>>.>---.+++++++..+++.>>.<-.<.+++.------.--------.>>+.>++."
+
+/**
+ * test_interpreter_nested_loops:
+ *
+ * Run a program containing nested loops and check its output.
+ */
+static void
+test_interpreter_nested_loops (void)
+{
+    g_autoptr (CattleInterpreter) interpreter = NULL;
+    g_autoptr (CattleProgram)     program = NULL;
+    g_autoptr (CattleBuffer)      buffer = NULL;
+    g_autoptr (GError)            error = NULL;
+    g_autoptr (GString)           output = NULL;
+    gboolean                      success;
+
+    interpreter = cattle_interpreter_new ();
+
+    buffer = cattle_buffer_new (strlen (PROGRAM_HELLO_WORLD));
+    cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_HELLO_WORLD);
+
+    program = cattle_interpreter_get_program (interpreter);
+    cattle_program_load (program, buffer, NULL);
+
+    output = g_string_new ("");
+
+    cattle_interpreter_set_output_handler (interpreter,
+                                           output_success_buffer,
+                                           output);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (success);
+    g_assert (error == NULL);
+    g_assert (g_utf8_collate (output->str, "Hello World!\n") == 0);
+}
+
+/**
+ * test_interpreter_reload:
+ *
+ * Make sure loading new code into a program that has already been run
+ * causes the new code to be executed.
+ */
+static void
+test_interpreter_reload (void)
+{
+    g_autoptr (CattleInterpreter) interpreter = NULL;
+    g_autoptr (CattleProgram)     program = NULL;
+    g_autoptr (CattleBuffer)      buffer1 = NULL;
+    g_autoptr (CattleBuffer)      buffer2 = NULL;
+    g_autoptr (GError)            error = NULL;
+    g_autoptr (GString)           output = NULL;
+    gboolean                      success;
+
+    interpreter = cattle_interpreter_new ();
+
+    buffer1 = cattle_buffer_new (4);
+    cattle_buffer_set_contents (buffer1, (gint8 *) "+++.");
+
+    buffer2 = cattle_buffer_new (3);
+    cattle_buffer_set_contents (buffer2, (gint8 *) "--.");
+
+    program = cattle_interpreter_get_program (interpreter);
+    cattle_program_load (program, buffer1, NULL);
+
+    output = g_string_new ("");
+
+    cattle_interpreter_set_output_handler (interpreter,
+                                           output_success_buffer,
+                                           output);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (success);
+
+    /* The tape is not cleared between runs, so the second program
+     * starts from the value left by the first one */
+    cattle_program_load (program, buffer2, NULL);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (success);
+
+    g_assert (output->len == 2);
+    g_assert (output->str[0] == 3);
+    g_assert (output->str[1] == 1);
+}
+
+/**
+ * test_interpreter_edit_instructions:
+ *
+ * Make sure changes to the instructions of a program that has already
+ * been run are picked up by the next run once they have been set
+ * again, and not before.
+ */
+static void
+test_interpreter_edit_instructions (void)
+{
+    g_autoptr (CattleInterpreter) interpreter = NULL;
+    g_autoptr (CattleProgram)     program = NULL;
+    g_autoptr (CattleInstruction) instruction = NULL;
+    g_autoptr (CattleBuffer)      buffer = NULL;
+    g_autoptr (GError)            error = NULL;
+    g_autoptr (GString)           output = NULL;
+    gboolean                      success;
+
+    interpreter = cattle_interpreter_new ();
+
+    buffer = cattle_buffer_new (4);
+    cattle_buffer_set_contents (buffer, (gint8 *) "+++.");
+
+    program = cattle_interpreter_get_program (interpreter);
+    cattle_program_load (program, buffer, NULL);
+
+    output = g_string_new ("");
+
+    cattle_interpreter_set_output_handler (interpreter,
+                                           output_success_buffer,
+                                           output);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (success);
+
+    /* Turn the first instruction into a decrease */
+    instruction = cattle_program_get_instructions (program);
+    cattle_instruction_set_value (instruction, CATTLE_INSTRUCTION_DECREASE);
+    cattle_instruction_set_quantity (instruction, 2);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (success);
+
+    cattle_program_set_instructions (program, instruction);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (success);
+
+    g_assert (output->len == 3);
+    g_assert (output->str[0] == 3);
+    g_assert (output->str[1] == 6);
+    g_assert (output->str[2] == 4);
+}
+
+/**
+ * test_interpreter_engines:
+ *
+ * Check all engines produce the same output for the same program.
+ */
+static void
+test_interpreter_engines (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    guint        i;
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        g_autoptr (CattleInterpreter)   interpreter = NULL;
+        g_autoptr (CattleConfiguration) configuration = NULL;
+        g_autoptr (CattleProgram)       program = NULL;
+        g_autoptr (CattleTape)          tape = NULL;
+        g_autoptr (CattleBuffer)        buffer = NULL;
+        g_autoptr (GError)              error = NULL;
+        g_autoptr (GString)             output = NULL;
+        gboolean                        success;
+
+        interpreter = cattle_interpreter_new ();
+
+        configuration = cattle_interpreter_get_configuration (interpreter);
+        cattle_configuration_set_engine (configuration, engines[i]);
+        g_assert (cattle_configuration_get_engine (configuration) == engines[i]);
+
+        buffer = cattle_buffer_new (strlen (PROGRAM_HELLO_WORLD));
+        cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_HELLO_WORLD);
+
+        program = cattle_interpreter_get_program (interpreter);
+        cattle_program_load (program, buffer, NULL);
+
+        output = g_string_new ("");
+
+        cattle_interpreter_set_output_handler (interpreter,
+                                               output_success_buffer,
+                                               output);
+
+        success = cattle_interpreter_run (interpreter, &error);
+        g_assert (success);
+        g_assert (error == NULL);
+        g_assert (g_utf8_collate (output->str, "Hello World!\n") == 0);
+
+        /* The tape must be left in the same state by all engines */
+        tape = cattle_interpreter_get_tape (interpreter);
+        g_assert (cattle_tape_get_current_value (tape) == '\n');
+        cattle_tape_move_right (tape);
+        g_assert (cattle_tape_is_at_end (tape));
+    }
+}
+
+#define PROGRAM_CLEAR_LOOPS "+++++[-].>+++[+].>--[---].>----[--]."
+
+/**
+ * test_interpreter_clear_loops:
+ *
+ * Run a program containing loops that clear the current cell, which
+ * are executed as a single operation.
+ */
+static void
+test_interpreter_clear_loops (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    guint        i;
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        g_autoptr (CattleInterpreter)   interpreter = NULL;
+        g_autoptr (CattleConfiguration) configuration = NULL;
+        g_autoptr (CattleProgram)       program = NULL;
+        g_autoptr (CattleBuffer)        buffer = NULL;
+        g_autoptr (GError)              error = NULL;
+        g_autoptr (GString)             output = NULL;
+        gboolean                        success;
+
+        interpreter = cattle_interpreter_new ();
+
+        configuration = cattle_interpreter_get_configuration (interpreter);
+        cattle_configuration_set_engine (configuration, engines[i]);
+
+        buffer = cattle_buffer_new (strlen (PROGRAM_CLEAR_LOOPS));
+        cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_CLEAR_LOOPS);
+
+        program = cattle_interpreter_get_program (interpreter);
+        cattle_program_load (program, buffer, NULL);
+
+        output = g_string_new ("");
+
+        cattle_interpreter_set_output_handler (interpreter,
+                                               output_success_buffer,
+                                               output);
+
+        success = cattle_interpreter_run (interpreter, &error);
+        g_assert (success);
+        g_assert (error == NULL);
+
+        g_assert (output->len == 4);
+        g_assert (output->str[0] == 0);
+        g_assert (output->str[1] == 0);
+        g_assert (output->str[2] == 0);
+        g_assert (output->str[3] == 0);
+    }
+}
+
+#define PROGRAM_MULTIPLY_LOOPS "++++++[->+++++++<]>.>++[--->+<]>.>-[+>++<]>.<<<<<[-<<+>>]"
+
+/**
+ * test_interpreter_multiply_loops:
+ *
+ * Run a program containing loops that add multiples of the current
+ * cell to other cells, which are executed without iterating.
+ */
+static void
+test_interpreter_multiply_loops (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    guint        i;
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        g_autoptr (CattleInterpreter)   interpreter = NULL;
+        g_autoptr (CattleConfiguration) configuration = NULL;
+        g_autoptr (CattleProgram)       program = NULL;
+        g_autoptr (CattleTape)          tape = NULL;
+        g_autoptr (CattleBuffer)        buffer = NULL;
+        g_autoptr (GError)              error = NULL;
+        g_autoptr (GString)             output = NULL;
+        gboolean                        success;
+
+        interpreter = cattle_interpreter_new ();
+
+        configuration = cattle_interpreter_get_configuration (interpreter);
+        cattle_configuration_set_engine (configuration, engines[i]);
+
+        buffer = cattle_buffer_new (strlen (PROGRAM_MULTIPLY_LOOPS));
+        cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_MULTIPLY_LOOPS);
+
+        program = cattle_interpreter_get_program (interpreter);
+        cattle_program_load (program, buffer, NULL);
+
+        output = g_string_new ("");
+
+        cattle_interpreter_set_output_handler (interpreter,
+                                               output_success_buffer,
+                                               output);
+
+        success = cattle_interpreter_run (interpreter, &error);
+        g_assert (success);
+        g_assert (error == NULL);
+
+        /* 6 * 7, then 2 - 3 * 86 = 0 modulo 256, then 255 + 1 = 0 */
+        g_assert (output->len == 3);
+        g_assert (output->str[0] == 42);
+        g_assert (output->str[1] == 86);
+        g_assert (output->str[2] == 2);
+
+        /* The last loop is not executed, so the tape must not grow */
+        tape = cattle_interpreter_get_tape (interpreter);
+        g_assert (cattle_tape_is_at_beginning (tape));
+    }
+}
+
+#define PROGRAM_BLOCKS "+>++>>---<<<<<<->>>>>>>>"
+
+/**
+ * test_interpreter_blocks:
+ *
+ * Run a program made of a single block of moves and updates, which
+ * is executed moving the tape only once. The tape must still grow to
+ * include all cells the block goes through.
+ */
+static void
+test_interpreter_blocks (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    guint        i;
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        g_autoptr (CattleInterpreter)   interpreter = NULL;
+        g_autoptr (CattleConfiguration) configuration = NULL;
+        g_autoptr (CattleProgram)       program = NULL;
+        g_autoptr (CattleTape)          tape = NULL;
+        g_autoptr (CattleBuffer)        buffer = NULL;
+        g_autoptr (GError)              error = NULL;
+        gboolean                        success;
+
+        interpreter = cattle_interpreter_new ();
+
+        configuration = cattle_interpreter_get_configuration (interpreter);
+        cattle_configuration_set_engine (configuration, engines[i]);
+
+        buffer = cattle_buffer_new (strlen (PROGRAM_BLOCKS));
+        cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_BLOCKS);
+
+        program = cattle_interpreter_get_program (interpreter);
+        cattle_program_load (program, buffer, NULL);
+
+        success = cattle_interpreter_run (interpreter, &error);
+        g_assert (success);
+        g_assert (error == NULL);
+
+        /* The block ends on the rightmost cell it reaches */
+        tape = cattle_interpreter_get_tape (interpreter);
+        g_assert (cattle_tape_is_at_end (tape));
+        g_assert (cattle_tape_get_current_value (tape) == 0);
+
+        cattle_tape_move_left_by (tape, 2);
+        g_assert (cattle_tape_get_current_value (tape) == -3);
+        cattle_tape_move_left_by (tape, 2);
+        g_assert (cattle_tape_get_current_value (tape) == 2);
+        cattle_tape_move_left (tape);
+        g_assert (cattle_tape_get_current_value (tape) == 1);
+
+        /* The cells between the updated ones are part of the tape */
+        cattle_tape_move_left_by (tape, 2);
+        g_assert (!cattle_tape_is_at_beginning (tape));
+        g_assert (cattle_tape_get_current_value (tape) == 0);
+        cattle_tape_move_left (tape);
+        g_assert (cattle_tape_is_at_beginning (tape));
+        g_assert (cattle_tape_get_current_value (tape) == -1);
+    }
+}
+
+/**
+ * test_interpreter_scan_loops:
+ *
+ * Run a program containing loops that move the tape until a cell
+ * containing zero is found, which are executed as a single search.
+ * The tape is long enough for it to grow several times along the way.
+ */
+static void
+test_interpreter_scan_loops (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    g_autoptr (GString) code = NULL;
+    guint               i;
+
+    /* Cells 0 to 599 contain one, except for cell 300 */
+    code = g_string_new ("");
+    for (i = 0; i < 300; i++)
+    {
+        g_string_append (code, "+>");
+    }
+    g_string_append (code, ">");
+    for (i = 0; i < 299; i++)
+    {
+        g_string_append (code, "+>");
+    }
+
+    /* Stop at cell 300, then go past the beginning of the tape */
+    g_string_append (code, "<[<]+++[<].");
+
+    /* Go all the way to the end of the tape, then back using a
+     * stride that touches cell 300 without stopping there */
+    g_string_append (code, "+>[>].<<<[<<<]>>.");
+
+    /* Go past the end of the tape using a stride that doesn't land
+     * on the last cell */
+    g_string_append (code, ">>>>>>>[>>>>>>>].");
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        g_autoptr (CattleInterpreter)   interpreter = NULL;
+        g_autoptr (CattleConfiguration) configuration = NULL;
+        g_autoptr (CattleProgram)       program = NULL;
+        g_autoptr (CattleTape)          tape = NULL;
+        g_autoptr (CattleBuffer)        buffer = NULL;
+        g_autoptr (GError)              error = NULL;
+        g_autoptr (GString)             output = NULL;
+        gboolean                        success;
+
+        interpreter = cattle_interpreter_new ();
+
+        configuration = cattle_interpreter_get_configuration (interpreter);
+        cattle_configuration_set_engine (configuration, engines[i]);
+
+        buffer = cattle_buffer_new (code->len);
+        cattle_buffer_set_contents (buffer, (gint8 *) code->str);
+
+        program = cattle_interpreter_get_program (interpreter);
+        cattle_program_load (program, buffer, NULL);
+
+        output = g_string_new ("");
+
+        cattle_interpreter_set_output_handler (interpreter,
+                                               output_success_buffer,
+                                               output);
+
+        success = cattle_interpreter_run (interpreter, &error);
+        g_assert (success);
+        g_assert (error == NULL);
+
+        g_assert (output->len == 4);
+        g_assert (output->str[0] == 0);
+        g_assert (output->str[1] == 0);
+        g_assert (output->str[2] == 1);
+        g_assert (output->str[3] == 0);
+
+        /* The last search stopped on a cell it had to create */
+        tape = cattle_interpreter_get_tape (interpreter);
+        g_assert (cattle_tape_is_at_end (tape));
+        g_assert (cattle_tape_get_current_value (tape) == 0);
+    }
+}
+
+#define PROGRAM_FIXED_TAPE "+>>>>>>>>>+<<<<<<<<<[>+<-]>."
+
+/**
+ * test_interpreter_fixed_tape:
+ *
+ * Run a program that reaches both ends of a fixed-size tape, both with
+ * and without bounds checking.
+ */
+static void
+test_interpreter_fixed_tape (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    guint        i;
+
+    for (i = 0; i < G_N_ELEMENTS (engines) * 2; i++)
+    {
+        g_autoptr (CattleInterpreter)   interpreter = NULL;
+        g_autoptr (CattleConfiguration) configuration = NULL;
+        g_autoptr (CattleProgram)       program = NULL;
+        g_autoptr (CattleTape)          tape = NULL;
+        g_autoptr (CattleBuffer)        buffer = NULL;
+        g_autoptr (GError)              error = NULL;
+        g_autoptr (GString)             output = NULL;
+        gboolean                        success;
+
+        interpreter = cattle_interpreter_new ();
+
+        configuration = cattle_interpreter_get_configuration (interpreter);
+        cattle_configuration_set_engine (configuration, engines[i / 2]);
+        cattle_configuration_set_tape_size (configuration, 10);
+        cattle_configuration_set_bounds_check_is_enabled (configuration, i % 2);
+
+        buffer = cattle_buffer_new (strlen (PROGRAM_FIXED_TAPE));
+        cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_FIXED_TAPE);
+
+        program = cattle_interpreter_get_program (interpreter);
+        cattle_program_load (program, buffer, NULL);
+
+        output = g_string_new ("");
+
+        cattle_interpreter_set_output_handler (interpreter,
+                                               output_success_buffer,
+                                               output);
+
+        success = cattle_interpreter_run (interpreter, &error);
+        g_assert (success);
+        g_assert (error == NULL);
+
+        g_assert (output->len == 1);
+        g_assert (output->str[0] == 1);
+
+        /* All cells exist from the start */
+        tape = cattle_interpreter_get_tape (interpreter);
+        cattle_tape_move_left (tape);
+        g_assert (cattle_tape_is_at_beginning (tape));
+        g_assert (cattle_tape_get_current_value (tape) == 0);
+        cattle_tape_move_right_by (tape, 9);
+        g_assert (cattle_tape_is_at_end (tape));
+        g_assert (cattle_tape_get_current_value (tape) == 1);
+    }
+}
+
+/**
+ * test_interpreter_out_of_bounds:
+ *
+ * Run programs that try to move past either end of a fixed-size tape
+ * in all possible ways, and make sure they are stopped.
+ */
+static void
+test_interpreter_out_of_bounds (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    const gchar *programs[] = { "<",
+                                ">>>>>>>>>>",
+                                "<>",
+                                ">>>>>>>>>><",
+                                "+[>+]",
+                                "+>+>+>+>+>+>+>+>+>+[<]",
+                                "+>>>+>>>+>>>+<<<<<<<<<[>>>]",
+                                "+[-<+>]",
+                                "+[->>>>>>>>>>+<<<<<<<<<<]" };
+    guint        i;
+    guint        j;
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        for (j = 0; j < G_N_ELEMENTS (programs); j++)
+        {
+            g_autoptr (CattleInterpreter)   interpreter = NULL;
+            g_autoptr (CattleConfiguration) configuration = NULL;
+            g_autoptr (CattleProgram)       program = NULL;
+            g_autoptr (CattleBuffer)        buffer = NULL;
+            g_autoptr (GError)              error = NULL;
+            gboolean                        success;
+
+            interpreter = cattle_interpreter_new ();
+
+            configuration = cattle_interpreter_get_configuration (interpreter);
+            cattle_configuration_set_engine (configuration, engines[i]);
+            cattle_configuration_set_tape_size (configuration, 10);
+
+            buffer = cattle_buffer_new (strlen (programs[j]));
+            cattle_buffer_set_contents (buffer, (gint8 *) programs[j]);
+
+            program = cattle_interpreter_get_program (interpreter);
+            cattle_program_load (program, buffer, NULL);
+
+            success = cattle_interpreter_run (interpreter, &error);
+            g_assert (!success);
+            g_assert (g_error_matches (error, CATTLE_ERROR, CATTLE_ERROR_TAPE_OUT_OF_BOUNDS));
+        }
+    }
+}
+
+/* Programs that move past either end of a four cell tape, which are
+ * run using each engine */
+static const CattleEngine unchecked_engines[] = {
+    CATTLE_ENGINE_SWITCH,
+    CATTLE_ENGINE_THREADED,
+    CATTLE_ENGINE_JIT
+};
+static const gchar *unchecked_programs[] = {
+    "<+.",
+    "<.",
+    ">>>>+",
+    ">>>>.",
+    ">>>>>>>>+<<<<<<<<."
+};
+
+/**
+ * test_interpreter_unchecked_bounds:
+ *
+ * Run a program that moves past either end of a fixed-size tape with
+ * bounds checking disabled, and make sure it's stopped the same way
+ * by all engines: it either crashes on the guard pages around the
+ * tape, or is stopped with an error when it calls back into the tape
+ * from outside of it. Either way, it never runs to completion.
+ */
+static void
+test_interpreter_unchecked_bounds (gconstpointer data)
+{
+    g_autoptr (CattleInterpreter)   interpreter = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    g_autoptr (CattleProgram)       program = NULL;
+    g_autoptr (CattleBuffer)        buffer = NULL;
+    g_autoptr (GError)              error = NULL;
+    g_autoptr (GString)             output = NULL;
+    const gchar                    *code;
+    guint                           i;
+    gboolean                        success;
+
+    if (!g_test_subprocess ())
+    {
+        g_test_trap_subprocess (NULL, 0, 0);
+        g_test_trap_assert_stderr_unmatched ("*CRITICAL*");
+        g_test_trap_assert_stderr_unmatched ("*ERROR*");
+
+        return;
+    }
+
+    i = GPOINTER_TO_UINT (data);
+    code = unchecked_programs[i % G_N_ELEMENTS (unchecked_programs)];
+
+    interpreter = cattle_interpreter_new ();
+
+    configuration = cattle_interpreter_get_configuration (interpreter);
+    cattle_configuration_set_engine (configuration,
+                                     unchecked_engines[i / G_N_ELEMENTS (unchecked_programs)]);
+    cattle_configuration_set_tape_size (configuration, 4);
+    cattle_configuration_set_bounds_check_is_enabled (configuration, FALSE);
+
+    buffer = cattle_buffer_new (strlen (code));
+    cattle_buffer_set_contents (buffer, (gint8 *) code);
+
+    program = cattle_interpreter_get_program (interpreter);
+    cattle_program_load (program, buffer, NULL);
+
+    output = g_string_new ("");
+
+    cattle_interpreter_set_output_handler (interpreter,
+                                           output_success_buffer,
+                                           output);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (!success);
+    g_assert (g_error_matches (error, CATTLE_ERROR, CATTLE_ERROR_TAPE_OUT_OF_BOUNDS));
+}
+
+/* Longer than the guard pages around any tape, in cells */
+#define LONG_MOVE (1 << 18)
+
+/**
+ * test_interpreter_unchecked_long_moves:
+ *
+ * Run programs that jump over the guard pages around a fixed-size
+ * tape with bounds checking disabled, either by moving or by updating
+ * a cell far away, and make sure they are stopped with an error by all
+ * engines instead of touching unrelated memory.
+ */
+static void
+test_interpreter_unchecked_long_moves (void)
+{
+    CattleEngine      engines[] = { CATTLE_ENGINE_SWITCH,
+                                    CATTLE_ENGINE_THREADED,
+                                    CATTLE_ENGINE_JIT };
+    g_autofree gchar *left = NULL;
+    g_autofree gchar *right = NULL;
+    gchar            *programs[4];
+    guint             i;
+    guint             j;
+
+    left = g_strnfill (LONG_MOVE, '<');
+    right = g_strnfill (LONG_MOVE, '>');
+
+    programs[0] = g_strconcat ("+", right, "+", left, ".", NULL);
+    programs[1] = g_strconcat ("+", left, "+", right, ".", NULL);
+    programs[2] = g_strconcat (right, ".", NULL);
+    programs[3] = g_strconcat (left, ".", NULL);
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        for (j = 0; j < G_N_ELEMENTS (programs); j++)
+        {
+            g_autoptr (CattleInterpreter)   interpreter = NULL;
+            g_autoptr (CattleConfiguration) configuration = NULL;
+            g_autoptr (CattleProgram)       program = NULL;
+            g_autoptr (CattleBuffer)        buffer = NULL;
+            g_autoptr (GError)              error = NULL;
+            gboolean                        success;
+
+            interpreter = cattle_interpreter_new ();
+
+            configuration = cattle_interpreter_get_configuration (interpreter);
+            cattle_configuration_set_engine (configuration, engines[i]);
+            cattle_configuration_set_tape_size (configuration, 4);
+            cattle_configuration_set_bounds_check_is_enabled (configuration, FALSE);
+
+            buffer = cattle_buffer_new (strlen (programs[j]));
+            cattle_buffer_set_contents (buffer, (gint8 *) programs[j]);
+
+            program = cattle_interpreter_get_program (interpreter);
+            cattle_program_load (program, buffer, NULL);
+
+            success = cattle_interpreter_run (interpreter, &error);
+            g_assert (!success);
+            g_assert (g_error_matches (error, CATTLE_ERROR, CATTLE_ERROR_TAPE_OUT_OF_BOUNDS));
+        }
+    }
+
+    for (j = 0; j < G_N_ELEMENTS (programs); j++)
+    {
+        g_free (programs[j]);
+    }
+}
+
+/**
+ * test_interpreter_tape_too_large:
+ *
+ * Make sure a tape that has already grown past the configured size is
+ * not truncated.
+ */
+static void
+test_interpreter_tape_too_large (void)
+{
+    g_autoptr (CattleInterpreter)   interpreter = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    g_autoptr (CattleTape)          tape = NULL;
+    g_autoptr (GError)              error = NULL;
+    gboolean                        success;
+
+    interpreter = cattle_interpreter_new ();
+
+    tape = cattle_interpreter_get_tape (interpreter);
+    cattle_tape_move_right_by (tape, 10);
+
+    configuration = cattle_interpreter_get_configuration (interpreter);
+    cattle_configuration_set_tape_size (configuration, 10);
+
+    success = cattle_interpreter_run (interpreter, &error);
+    g_assert (!success);
+    g_assert (g_error_matches (error, CATTLE_ERROR, CATTLE_ERROR_TAPE_OUT_OF_BOUNDS));
+}
+
+#define PROGRAM_CELL_WIDTHS "++++++++++++++++[->++++++++++++++++<]>[->++++++++++++++++<]>[->++++++++++++++++<]>+.>-.>,!\xc8"
+
+/**
+ * test_interpreter_cell_widths:
+ *
+ * Run a program whose values only fit in 32 bit cells using all cell
+ * widths, and make sure they wrap around accordingly.
+ */
+static void
+test_interpreter_cell_widths (void)
+{
+    CattleEngine    engines[] = { CATTLE_ENGINE_SWITCH,
+                                  CATTLE_ENGINE_THREADED,
+                                  CATTLE_ENGINE_JIT };
+    CattleCellWidth widths[] = { CATTLE_CELL_WIDTH_8,
+                                 CATTLE_CELL_WIDTH_16,
+                                 CATTLE_CELL_WIDTH_32 };
+    guint           i;
+
+    for (i = 0; i < G_N_ELEMENTS (engines) * G_N_ELEMENTS (widths); i++)
+    {
+        g_autoptr (CattleInterpreter)   interpreter = NULL;
+        g_autoptr (CattleConfiguration) configuration = NULL;
+        g_autoptr (CattleProgram)       program = NULL;
+        g_autoptr (CattleTape)          tape = NULL;
+        g_autoptr (CattleBuffer)        buffer = NULL;
+        g_autoptr (GError)              error = NULL;
+        g_autoptr (GString)             output = NULL;
+        CattleCellWidth                 width;
+        gboolean                        success;
+
+        width = widths[i % G_N_ELEMENTS (widths)];
+
+        interpreter = cattle_interpreter_new ();
+
+        configuration = cattle_interpreter_get_configuration (interpreter);
+        cattle_configuration_set_engine (configuration, engines[i / G_N_ELEMENTS (widths)]);
+        cattle_configuration_set_cell_width (configuration, width);
+
+        buffer = cattle_buffer_new (strlen (PROGRAM_CELL_WIDTHS));
+        cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_CELL_WIDTHS);
+
+        program = cattle_interpreter_get_program (interpreter);
+        cattle_program_load (program, buffer, NULL);
+
+        output = g_string_new ("");
+
+        cattle_interpreter_set_output_handler (interpreter,
+                                               output_success_buffer,
+                                               output);
+
+        success = cattle_interpreter_run (interpreter, &error);
+        g_assert (success);
+        g_assert (error == NULL);
+
+        /* Only the lowest 8 bits are printed */
+        g_assert (output->len == 2);
+        g_assert (output->str[0] == 1);
+        g_assert (output->str[1] == (gchar) 0xff);
+
+        /* Input is not sign-extended in wider cells */
+        tape = cattle_interpreter_get_tape (interpreter);
+        if (width == CATTLE_CELL_WIDTH_8)
+        {
+            g_assert (cattle_tape_get_current_wide_value (tape) == (gint8) 0xc8);
+        }
+        else
+        {
+            g_assert (cattle_tape_get_current_wide_value (tape) == 0xc8);
+        }
+
+        /* 0 - 1 = -1 regardless of the width */
+        cattle_tape_move_left (tape);
+        g_assert (cattle_tape_get_current_wide_value (tape) == -1);
+        g_assert (cattle_tape_get_current_value (tape) == -1);
+
+        /* 16^4 + 1 */
+        cattle_tape_move_left (tape);
+        if (width == CATTLE_CELL_WIDTH_32)
+        {
+            g_assert (cattle_tape_get_current_wide_value (tape) == 65537);
+        }
+        else
+        {
+            g_assert (cattle_tape_get_current_wide_value (tape) == 1);
+        }
+        g_assert (cattle_tape_get_current_value (tape) == 1);
+    }
+}
+
+#define SHARED_THREADS 4
+
+typedef struct
+{
+    CattleProgram *program;
+    CattleEngine   engine;
+} SharedRun;
+
+/* Run a program shared with other threads using a new interpreter,
+ * and return its output */
+static gpointer
+run_shared_program (gpointer data)
+{
+    g_autoptr (CattleInterpreter)   interpreter = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    SharedRun                      *run;
+    GString                        *output;
+    gboolean                        success;
+
+    run = (SharedRun *) data;
+
+    interpreter = cattle_interpreter_new ();
+    cattle_interpreter_set_program (interpreter, run->program);
+
+    configuration = cattle_interpreter_get_configuration (interpreter);
+    cattle_configuration_set_engine (configuration, run->engine);
+
+    output = g_string_new ("");
+
+    cattle_interpreter_set_output_handler (interpreter,
+                                           output_success_buffer,
+                                           output);
+
+    success = cattle_interpreter_run (interpreter, NULL);
+    g_assert (success);
+
+    return output;
+}
+
+/**
+ * test_interpreter_shared_program:
+ *
+ * Run the same program from several threads at once, each with its
+ * own interpreter, and make sure the compiled code they share is
+ * created and released correctly.
+ */
+static void
+test_interpreter_shared_program (void)
+{
+    CattleEngine engines[] = { CATTLE_ENGINE_SWITCH,
+                               CATTLE_ENGINE_THREADED,
+                               CATTLE_ENGINE_JIT };
+    guint        i;
+    guint        j;
+
+    for (i = 0; i < G_N_ELEMENTS (engines); i++)
+    {
+        g_autoptr (CattleProgram) program = NULL;
+        g_autoptr (CattleBuffer)  buffer = NULL;
+        GThread                  *threads[SHARED_THREADS];
+        SharedRun                 run;
+
+        buffer = cattle_buffer_new (strlen (PROGRAM_HELLO_WORLD));
+        cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_HELLO_WORLD);
+
+        program = cattle_program_new ();
+        cattle_program_load (program, buffer, NULL);
+
+        run.program = program;
+        run.engine = engines[i];
+
+        for (j = 0; j < SHARED_THREADS; j++)
+        {
+            threads[j] = g_thread_new (NULL, run_shared_program, &run);
+        }
+
+        for (j = 0; j < SHARED_THREADS; j++)
+        {
+            g_autoptr (GString) output = NULL;
+
+            output = g_thread_join (threads[j]);
+            g_assert (g_utf8_collate (output->str, "Hello World!\n") == 0);
+        }
+    }
+}
+
 gint
 main (gint    argc,
       gchar **argv)
 {
+    guint i;
+
     g_test_init (&argc, &argv, NULL);
 
     g_test_add_func ("/interpreter/handlers",
                      test_interpreter_handlers);
+    g_test_add_func ("/interpreter/bulk-input",
+                     test_interpreter_bulk_input);
+    g_test_add_func ("/interpreter/bulk-output",
+                     test_interpreter_bulk_output);
     g_test_add_func ("/interpreter/failed-input",
                      test_interpreter_failed_input);
     g_test_add_func ("/interpreter/failed-output",
@@ -610,6 +1756,43 @@ main (gint    argc,
                      test_interpreter_invalid_input);
     g_test_add_func ("/interpreter/unbalanced-brackets",
                      test_interpreter_unbalanced_brackets);
+    g_test_add_func ("/interpreter/nested-loops",
+                     test_interpreter_nested_loops);
+    g_test_add_func ("/interpreter/reload",
+                     test_interpreter_reload);
+    g_test_add_func ("/interpreter/edit-instructions",
+                     test_interpreter_edit_instructions);
+    g_test_add_func ("/interpreter/engines",
+                     test_interpreter_engines);
+    g_test_add_func ("/interpreter/clear-loops",
+                     test_interpreter_clear_loops);
+    g_test_add_func ("/interpreter/multiply-loops",
+                     test_interpreter_multiply_loops);
+    g_test_add_func ("/interpreter/blocks",
+                     test_interpreter_blocks);
+    g_test_add_func ("/interpreter/scan-loops",
+                     test_interpreter_scan_loops);
+    g_test_add_func ("/interpreter/fixed-tape",
+                     test_interpreter_fixed_tape);
+    g_test_add_func ("/interpreter/out-of-bounds",
+                     test_interpreter_out_of_bounds);
+    for (i = 0; i < G_N_ELEMENTS (unchecked_engines) * G_N_ELEMENTS (unchecked_programs); i++)
+    {
+        g_autofree gchar *path = NULL;
+
+        path = g_strdup_printf ("/interpreter/unchecked-bounds/%u", i);
+        g_test_add_data_func (path,
+                              GUINT_TO_POINTER (i),
+                              test_interpreter_unchecked_bounds);
+    }
+    g_test_add_func ("/interpreter/unchecked-long-moves",
+                     test_interpreter_unchecked_long_moves);
+    g_test_add_func ("/interpreter/tape-too-large",
+                     test_interpreter_tape_too_large);
+    g_test_add_func ("/interpreter/cell-widths",
+                     test_interpreter_cell_widths);
+    g_test_add_func ("/interpreter/shared-program",
+                     test_interpreter_shared_program);
 
     return g_test_run ();
 }
@@ -205,6 +205,209 @@ test_program_load_with_input (void)
     g_assert (instruction_value == CATTLE_INSTRUCTION_READ);
 }
 
+#define PROGRAM_RUNS "+ +\n+ add four\n+-- >> <<<\n. ."
+
+/**
+ * test_program_load_runs:
+ *
+ * Load a program whose runs of identical symbols are interrupted by
+ * comments and whitespace, or undone by the opposite symbol.
+ */
+static void
+test_program_load_runs (void)
+{
+    g_autoptr (CattleProgram)     program = NULL;
+    g_autoptr (CattleBuffer)      buffer = NULL;
+    g_autoptr (CattleInstruction) first = NULL;
+    g_autoptr (CattleInstruction) second = NULL;
+    g_autoptr (CattleInstruction) third = NULL;
+    g_autoptr (CattleInstruction) fourth = NULL;
+    g_autoptr (CattleInstruction) fifth = NULL;
+    g_autoptr (GError)            error = NULL;
+    gboolean                      success;
+
+    program = cattle_program_new ();
+
+    buffer = cattle_buffer_new (strlen (PROGRAM_RUNS));
+    cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_RUNS);
+
+    success = cattle_program_load (program, buffer, &error);
+
+    g_assert (success);
+    g_assert (error == NULL);
+
+    /* Four increases minus two decreases */
+    first = cattle_program_get_instructions (program);
+    g_assert (cattle_instruction_get_value (first) == CATTLE_INSTRUCTION_INCREASE);
+    g_assert (cattle_instruction_get_quantity (first) == 2);
+
+    /* Moves are never undone, because the cells they pass over
+     * are reached all the same */
+    second = cattle_instruction_get_next (first);
+    g_assert (cattle_instruction_get_value (second) == CATTLE_INSTRUCTION_MOVE_RIGHT);
+    g_assert (cattle_instruction_get_quantity (second) == 2);
+
+    third = cattle_instruction_get_next (second);
+    g_assert (cattle_instruction_get_value (third) == CATTLE_INSTRUCTION_MOVE_LEFT);
+    g_assert (cattle_instruction_get_quantity (third) == 3);
+
+    fourth = cattle_instruction_get_next (third);
+    g_assert (cattle_instruction_get_value (fourth) == CATTLE_INSTRUCTION_PRINT);
+    g_assert (cattle_instruction_get_quantity (fourth) == 2);
+
+    fifth = cattle_instruction_get_next (fourth);
+    g_assert (fifth == NULL);
+}
+
+#define PROGRAM_LARGE_SIZE (50 * 1024 * 1024)
+#define PROGRAM_LARGE_RUN  25
+
+/**
+ * test_program_load_large:
+ *
+ * Load and release a 50 MiB program made of millions of instructions.
+ * Releasing it must not require one stack frame per instruction.
+ */
+static void
+test_program_load_large (void)
+{
+    g_autoptr (CattleProgram) program = NULL;
+    g_autoptr (CattleBuffer)  buffer = NULL;
+    g_autoptr (GError)        error = NULL;
+    CattleInstruction        *instructions;
+    gint8                    *code;
+    gulong                    i;
+    gboolean                  success;
+
+    /* Alternate runs of increases and moves, so that each run is
+     * loaded as a separate instruction */
+    code = g_new (gint8, PROGRAM_LARGE_SIZE);
+    for (i = 0; i < PROGRAM_LARGE_SIZE; i++)
+    {
+        code[i] = ((i / PROGRAM_LARGE_RUN) % 2) ? '>' : '+';
+    }
+
+    buffer = cattle_buffer_new (PROGRAM_LARGE_SIZE);
+    cattle_buffer_set_contents (buffer, code);
+    g_free (code);
+
+    program = cattle_program_new ();
+    success = cattle_program_load (program, buffer, &error);
+
+    g_assert (success);
+    g_assert (error == NULL);
+
+    /* Loaded programs are stored as nodes: create the instructions
+     * too, so that there's a long chain of them to release */
+    instructions = cattle_program_get_instructions (program);
+    g_assert (instructions != NULL);
+    g_object_unref (instructions);
+
+    g_clear_object (&program);
+}
+
+#define PROGRAM_CLOSED_FIRST "+][-"
+
+/**
+ * test_program_load_closed_first:
+ *
+ * Make sure a program that closes a loop before opening it is not
+ * loaded, even though it contains as many open brackets as closed
+ * ones.
+ */
+static void
+test_program_load_closed_first (void)
+{
+    g_autoptr (CattleProgram) program = NULL;
+    g_autoptr (CattleBuffer)  buffer = NULL;
+    g_autoptr (GError)        error = NULL;
+    gboolean                  success;
+
+    program = cattle_program_new ();
+
+    buffer = cattle_buffer_new (strlen (PROGRAM_CLOSED_FIRST));
+    cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_CLOSED_FIRST);
+
+    success = cattle_program_load (program, buffer, &error);
+
+    g_assert (!success);
+    g_assert (g_error_matches (error, CATTLE_ERROR, CATTLE_ERROR_UNBALANCED_BRACKETS));
+}
+
+#define PROGRAM_DEEP_NESTING 100000
+
+/**
+ * test_program_load_deep_nesting:
+ *
+ * Load a program containing a hundred thousand nested loops, which
+ * must not require one stack frame per loop.
+ */
+static void
+test_program_load_deep_nesting (void)
+{
+    g_autoptr (CattleProgram)     program = NULL;
+    g_autoptr (CattleBuffer)      buffer = NULL;
+    g_autoptr (CattleInstruction) instructions = NULL;
+    g_autoptr (GError)            error = NULL;
+    gint8                        *code;
+    gulong                        i;
+    gboolean                      success;
+
+    code = g_new (gint8, 2 * PROGRAM_DEEP_NESTING);
+    for (i = 0; i < PROGRAM_DEEP_NESTING; i++)
+    {
+        code[i] = '[';
+        code[2 * PROGRAM_DEEP_NESTING - i - 1] = ']';
+    }
+
+    buffer = cattle_buffer_new (2 * PROGRAM_DEEP_NESTING);
+    cattle_buffer_set_contents (buffer, code);
+    g_free (code);
+
+    program = cattle_program_new ();
+    success = cattle_program_load (program, buffer, &error);
+
+    g_assert (success);
+    g_assert (error == NULL);
+
+    instructions = cattle_program_get_instructions (program);
+
+    g_assert (cattle_instruction_get_value (instructions) == CATTLE_INSTRUCTION_LOOP_BEGIN);
+    g_assert (cattle_instruction_get_next (instructions) == NULL);
+}
+
+/**
+ * test_program_instructions_created_once:
+ *
+ * Make sure the instructions for a loaded program, which are created
+ * the first time they're requested, are not created again later.
+ */
+static void
+test_program_instructions_created_once (void)
+{
+    g_autoptr (CattleProgram)     program = NULL;
+    g_autoptr (CattleBuffer)      buffer = NULL;
+    g_autoptr (CattleInstruction) first = NULL;
+    g_autoptr (CattleInstruction) second = NULL;
+    g_autoptr (GError)            error = NULL;
+    gboolean                      success;
+
+    program = cattle_program_new ();
+
+    buffer = cattle_buffer_new (strlen (PROGRAM_RUNS));
+    cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_RUNS);
+
+    success = cattle_program_load (program, buffer, &error);
+
+    g_assert (success);
+    g_assert (error == NULL);
+
+    first = cattle_program_get_instructions (program);
+    second = cattle_program_get_instructions (program);
+
+    g_assert (first == second);
+}
+
 #define PROGRAM_DOUBLE_LOOP "[[]]"
 
 /**
@@ -297,6 +500,142 @@ test_program_load_double_loop (void)
     g_assert (nothing == NULL);
 }
 
+#define PROGRAM_EMIT_C "+[->,.<]#!x"
+
+/**
+ * test_program_emit_c:
+ *
+ * Translate a program to C and check the result contains what's
+ * expected.
+ */
+static void
+test_program_emit_c (void)
+{
+    g_autoptr (CattleProgram)       program = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    g_autoptr (CattleBuffer)        buffer = NULL;
+    g_autoptr (GError)              error = NULL;
+    g_autofree gchar               *code = NULL;
+    gboolean                        success;
+
+    program = cattle_program_new ();
+    configuration = cattle_configuration_new ();
+
+    buffer = cattle_buffer_new (strlen (PROGRAM_EMIT_C));
+    cattle_buffer_set_contents (buffer, (gint8 *) PROGRAM_EMIT_C);
+
+    success = cattle_program_load (program, buffer, &error);
+
+    g_assert (success);
+    g_assert (error == NULL);
+
+    code = cattle_program_emit_c (program, configuration, &error);
+
+    g_assert (code != NULL);
+    g_assert (error == NULL);
+
+    g_assert (strstr (code, "int\nmain (void)\n") != NULL);
+    g_assert (strstr (code, "    while (*p)\n    {\n        *p -= 1;\n") != NULL);
+    g_assert (strstr (code, "read_input (p, 1UL);") != NULL);
+    g_assert (strstr (code, "output (*p, 1UL);") != NULL);
+
+    /* The input is embedded */
+    g_assert (strstr (code, "input_data[] = {\n    0x78,\n};") != NULL);
+
+    /* Debugging is disabled */
+    g_assert (strstr (code, "debug (p);") == NULL);
+
+    g_free (code);
+
+    cattle_configuration_set_debug_is_enabled (configuration, TRUE);
+
+    code = cattle_program_emit_c (program, configuration, &error);
+
+    g_assert (code != NULL);
+    g_assert (strstr (code, "debug (p);") != NULL);
+}
+
+/**
+ * test_program_emit_c_configuration:
+ *
+ * Translate a program to C using wide cells and a fixed-size tape, and
+ * make sure the result uses both.
+ */
+static void
+test_program_emit_c_configuration (void)
+{
+    g_autoptr (CattleProgram)       program = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    g_autoptr (CattleBuffer)        buffer = NULL;
+    g_autoptr (GError)              error = NULL;
+    g_autofree gchar               *code = NULL;
+    gchar                          *increases;
+    gboolean                        success;
+
+    program = cattle_program_new ();
+    configuration = cattle_configuration_new ();
+
+    /* More increases than an 8 bit cell can hold, then a move */
+    increases = g_strnfill (300, '+');
+    buffer = cattle_buffer_new (301);
+    cattle_buffer_set_contents (buffer, (gint8 *) increases);
+    cattle_buffer_set_value (buffer, 300, '>');
+    g_free (increases);
+
+    success = cattle_program_load (program, buffer, &error);
+
+    g_assert (success);
+    g_assert (error == NULL);
+
+    cattle_configuration_set_cell_width (configuration, CATTLE_CELL_WIDTH_16);
+    cattle_configuration_set_tape_size (configuration, 10);
+
+    code = cattle_program_emit_c (program, configuration, &error);
+
+    g_assert (code != NULL);
+    g_assert (error == NULL);
+
+    /* The whole quantity is kept */
+    g_assert (strstr (code, "typedef uint16_t cell;") != NULL);
+    g_assert (strstr (code, "*p += 300;") != NULL);
+
+    /* The tape is allocated up front and moves are checked */
+    g_assert (strstr (code, "static cell tape[TAPE_SIZE];") != NULL);
+    g_assert (strstr (code, "#define TAPE_SIZE 10UL") != NULL);
+    g_assert (strstr (code, "out_of_bounds ();") != NULL);
+    g_assert (strstr (code, "resize (") == NULL);
+}
+
+/**
+ * test_program_emit_c_unbalanced_brackets:
+ *
+ * Make sure a program containing unbalanced brackets is not translated
+ * to C, and that the correct error is reported.
+ */
+static void
+test_program_emit_c_unbalanced_brackets (void)
+{
+    g_autoptr (CattleProgram)       program = NULL;
+    g_autoptr (CattleConfiguration) configuration = NULL;
+    g_autoptr (CattleInstruction)   instructions = NULL;
+    g_autoptr (GError)              error = NULL;
+    g_autofree gchar               *code = NULL;
+
+    program = cattle_program_new ();
+    configuration = cattle_configuration_new ();
+
+    /* Create a program containing a single ] */
+    instructions = cattle_instruction_new ();
+    cattle_instruction_set_value (instructions,
+                                  CATTLE_INSTRUCTION_LOOP_END);
+    cattle_program_set_instructions (program, instructions);
+
+    code = cattle_program_emit_c (program, configuration, &error);
+
+    g_assert (code == NULL);
+    g_assert (g_error_matches (error, CATTLE_ERROR, CATTLE_ERROR_UNBALANCED_BRACKETS));
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -310,8 +649,24 @@ main (gint argc, gchar **argv)
                      test_program_load_without_input);
     g_test_add_func ("/program/load-with-input",
                      test_program_load_with_input);
+    g_test_add_func ("/program/load-runs",
+                     test_program_load_runs);
+    g_test_add_func ("/program/load-closed-first",
+                     test_program_load_closed_first);
+    g_test_add_func ("/program/load-deep-nesting",
+                     test_program_load_deep_nesting);
+    g_test_add_func ("/program/load-large",
+                     test_program_load_large);
+    g_test_add_func ("/program/instructions-created-once",
+                     test_program_instructions_created_once);
     g_test_add_func ("/program/load-double-loop",
                      test_program_load_double_loop);
+    g_test_add_func ("/program/emit-c",
+                     test_program_emit_c);
+    g_test_add_func ("/program/emit-c-configuration",
+                     test_program_emit_c_configuration);
+    g_test_add_func ("/program/emit-c-unbalanced-brackets",
+                     test_program_emit_c_unbalanced_brackets);
 
     return g_test_run ();
 }
@@ -21,8 +21,17 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <cattle/cattle.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 
 #define STEPS 1024
+#define LONG_STEPS 1000000
+#define RESERVED_STEPS (1 << 24)
 
 /**
  * test_tape_initial_position:
@@ -192,6 +201,136 @@ test_tape_move_left (void)
     g_assert (cattle_tape_get_current_value (tape) == G_MAXINT8);
 }
 
+/**
+ * test_tape_long_moves:
+ *
+ * Move far away in both directions with a single call, and make sure
+ * the cells in between are created and the values are preserved.
+ */
+static void
+test_tape_long_moves (void)
+{
+    g_autoptr (CattleTape) tape = NULL;
+
+    tape = cattle_tape_new ();
+
+    /* Mark the initial position */
+    cattle_tape_set_current_value (tape, 42);
+
+    /* Move right and mark the final position */
+    cattle_tape_move_right_by (tape, LONG_STEPS);
+    g_assert (cattle_tape_is_at_end (tape));
+    g_assert (cattle_tape_get_current_value (tape) == 0);
+    cattle_tape_set_current_value (tape, G_MAXINT8);
+
+    /* Move left past the initial position and mark it as well */
+    cattle_tape_move_left_by (tape, 2 * LONG_STEPS);
+    g_assert (cattle_tape_is_at_beginning (tape));
+    g_assert (cattle_tape_get_current_value (tape) == 0);
+    cattle_tape_set_current_value (tape, G_MININT8);
+
+    /* All values must have survived the tape growing */
+    cattle_tape_move_right_by (tape, LONG_STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == 42);
+    cattle_tape_move_right_by (tape, LONG_STEPS);
+    g_assert (cattle_tape_is_at_end (tape));
+    g_assert (cattle_tape_get_current_value (tape) == G_MAXINT8);
+    cattle_tape_move_left_by (tape, 2 * LONG_STEPS);
+    g_assert (cattle_tape_is_at_beginning (tape));
+    g_assert (cattle_tape_get_current_value (tape) == G_MININT8);
+}
+
+/**
+ * test_tape_reserved_growth:
+ *
+ * Move further in both directions than the storage reserved when a
+ * tape is created reaches, so that it has to be moved, and make sure
+ * the values are preserved.
+ */
+static void
+test_tape_reserved_growth (void)
+{
+    g_autoptr (CattleTape) tape = NULL;
+
+    tape = cattle_tape_new ();
+
+    cattle_tape_set_current_value (tape, 42);
+
+    cattle_tape_move_right_by (tape, RESERVED_STEPS);
+    g_assert (cattle_tape_is_at_end (tape));
+    cattle_tape_set_current_value (tape, G_MAXINT8);
+
+    cattle_tape_move_left_by (tape, 2 * RESERVED_STEPS);
+    g_assert (cattle_tape_is_at_beginning (tape));
+    cattle_tape_set_current_value (tape, G_MININT8);
+
+    cattle_tape_move_right_by (tape, RESERVED_STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == 42);
+    cattle_tape_move_right_by (tape, RESERVED_STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == G_MAXINT8);
+    cattle_tape_move_left_by (tape, 2 * RESERVED_STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == G_MININT8);
+}
+
+/**
+ * test_tape_heap_fallback:
+ *
+ * Limit the address space so that memory can't be mapped for the
+ * storage of a tape, and make sure the tape still works and can grow,
+ * using memory allocated on the heap instead.
+ */
+static void
+test_tape_heap_fallback (void)
+{
+#ifdef __linux__
+    g_autoptr (CattleTape) tape = NULL;
+    g_autofree gchar      *statm = NULL;
+    struct rlimit          limit;
+    gulong                 pages;
+
+    /* The address space can't be grown back once it's been limited,
+     * so that has to happen in a separate process */
+    if (!g_test_subprocess ())
+    {
+        g_test_trap_subprocess (NULL, 0, 0);
+        g_test_trap_assert_passed ();
+
+        return;
+    }
+
+    /* Don't leave any room for new mappings. Small allocations can
+     * still be served from the memory the heap already has */
+    g_assert (g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL));
+    pages = strtoul (statm, NULL, 10);
+
+    limit.rlim_cur = pages * sysconf (_SC_PAGESIZE);
+    limit.rlim_max = limit.rlim_cur;
+    g_assert (setrlimit (RLIMIT_AS, &limit) == 0);
+
+    tape = cattle_tape_new ();
+
+    cattle_tape_set_current_value (tape, 42);
+
+    /* Grow the tape in both directions */
+    cattle_tape_move_right_by (tape, STEPS);
+    g_assert (cattle_tape_is_at_end (tape));
+    cattle_tape_set_current_value (tape, G_MAXINT8);
+
+    cattle_tape_move_left_by (tape, 2 * STEPS);
+    g_assert (cattle_tape_is_at_beginning (tape));
+    cattle_tape_set_current_value (tape, G_MININT8);
+
+    cattle_tape_move_right_by (tape, STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == 42);
+    cattle_tape_move_right_by (tape, STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == G_MAXINT8);
+    cattle_tape_move_left_by (tape, 2 * STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == G_MININT8);
+#else
+    g_test_skip ("The address space can't be limited");
+#endif
+}
+
 /**
  * test_tape_bookmarks:
  *
@@ -221,6 +360,45 @@ test_tape_bookmarks (void)
     g_assert (cattle_tape_get_current_value (tape) == 42);
 }
 
+/**
+ * test_tape_positions:
+ *
+ * Save a few positions and restore them in an arbitrary order, making
+ * sure they stay valid while the tape grows on either side.
+ */
+static void
+test_tape_positions (void)
+{
+    g_autoptr (CattleTape) tape = NULL;
+    CattleTapePosition     left;
+    CattleTapePosition     right;
+
+    tape = cattle_tape_new ();
+
+    /* Save a position on the left */
+    cattle_tape_move_left_by (tape, 20);
+    cattle_tape_set_current_value (tape, 42);
+    cattle_tape_save_position (tape, &left);
+
+    /* Save another one on the right */
+    cattle_tape_move_right_by (tape, 70);
+    cattle_tape_set_current_value (tape, 23);
+    cattle_tape_save_position (tape, &right);
+
+    /* Grow the tape a lot in both directions */
+    cattle_tape_move_left_by (tape, LONG_STEPS);
+    cattle_tape_move_right_by (tape, 2 * LONG_STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == 0);
+
+    /* Positions can be restored any number of times, in any order */
+    cattle_tape_restore_position (tape, &left);
+    g_assert (cattle_tape_get_current_value (tape) == 42);
+    cattle_tape_restore_position (tape, &right);
+    g_assert (cattle_tape_get_current_value (tape) == 23);
+    cattle_tape_restore_position (tape, &left);
+    g_assert (cattle_tape_get_current_value (tape) == 42);
+}
+
 /**
  * test_tape_current_value:
  *
@@ -366,6 +544,95 @@ test_tape_negative_wrap (void)
     g_assert (cattle_tape_get_current_value (tape) == 42);
 }
 
+/**
+ * test_tape_values:
+ *
+ * Copy ranges of values in and out of the tape, and make sure they
+ * match what moving one cell at a time finds.
+ */
+static void
+test_tape_values (void)
+{
+    g_autoptr (CattleTape) tape = NULL;
+    const gint8           *view;
+    gint8                  values[STEPS];
+    gint8                  copy[STEPS];
+    gint                   i;
+
+    tape = cattle_tape_new ();
+
+    for (i = 0; i < STEPS; i++)
+    {
+        values[i] = (gint8) (i * 7);
+    }
+
+    /* Grow the tape on the left, so that the current cell is no longer
+     * the first one */
+    cattle_tape_move_left_by (tape, 10);
+    cattle_tape_move_right_by (tape, 10);
+    g_assert (cattle_tape_get_length (tape) == 11);
+    g_assert (cattle_tape_get_position (tape) == 10);
+
+    /* Setting values past the end grows the tape without moving */
+    cattle_tape_set_values (tape, 1, STEPS, values);
+    g_assert (cattle_tape_get_length (tape) == STEPS + 1);
+    g_assert (cattle_tape_get_position (tape) == 10);
+    g_assert (cattle_tape_get_current_value (tape) == values[9]);
+
+    cattle_tape_get_values (tape, 1, STEPS, copy);
+    g_assert (memcmp (values, copy, STEPS) == 0);
+
+    view = cattle_tape_peek_values (tape, 1, STEPS);
+    g_assert (view != NULL);
+    g_assert (memcmp (values, view, STEPS) == 0);
+
+    /* Check the values one at a time */
+    cattle_tape_move_left_by (tape, 10);
+    g_assert (cattle_tape_is_at_beginning (tape));
+    g_assert (cattle_tape_get_current_value (tape) == 0);
+
+    for (i = 0; i < STEPS; i++)
+    {
+        cattle_tape_move_right (tape);
+        g_assert (cattle_tape_get_current_value (tape) == values[i]);
+    }
+    g_assert (cattle_tape_is_at_end (tape));
+}
+
+/**
+ * test_tape_clear:
+ *
+ * Clear a tape that has been used, and make sure it looks like a new
+ * one afterwards.
+ */
+static void
+test_tape_clear (void)
+{
+    g_autoptr (CattleTape) tape = NULL;
+
+    tape = cattle_tape_new ();
+
+    /* Leave some values behind on both sides */
+    cattle_tape_move_left_by (tape, STEPS);
+    cattle_tape_set_current_value (tape, 42);
+    cattle_tape_move_right_by (tape, 2 * STEPS);
+    cattle_tape_set_current_value (tape, 42);
+    cattle_tape_push_bookmark (tape);
+
+    cattle_tape_clear (tape);
+
+    g_assert (cattle_tape_is_at_beginning (tape));
+    g_assert (cattle_tape_is_at_end (tape));
+    g_assert (cattle_tape_get_current_value (tape) == 0);
+    g_assert (!cattle_tape_pop_bookmark (tape));
+
+    /* The cells that used to be there must have been cleared */
+    cattle_tape_move_left_by (tape, STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == 0);
+    cattle_tape_move_right_by (tape, 2 * STEPS);
+    g_assert (cattle_tape_get_current_value (tape) == 0);
+}
+
 gint
 main (gint argc, gchar **argv)
 {
@@ -383,8 +650,16 @@ main (gint argc, gchar **argv)
                      test_tape_move_right);
     g_test_add_func ("/tape/move-left",
                      test_tape_move_left);
+    g_test_add_func ("/tape/long-moves",
+                     test_tape_long_moves);
+    g_test_add_func ("/tape/reserved-growth",
+                     test_tape_reserved_growth);
+    g_test_add_func ("/tape/heap-fallback",
+                     test_tape_heap_fallback);
     g_test_add_func ("/tape/bookmarks",
                      test_tape_bookmarks);
+    g_test_add_func ("/tape/positions",
+                     test_tape_positions);
     g_test_add_func ("/tape/current-value",
                      test_tape_current_value);
     g_test_add_func ("/tape/increase-current-value",
@@ -395,6 +670,10 @@ main (gint argc, gchar **argv)
                      test_tape_positive_wrap);
     g_test_add_func ("/tape/negative-wrap",
                      test_tape_negative_wrap);
+    g_test_add_func ("/tape/values",
+                     test_tape_values);
+    g_test_add_func ("/tape/clear",
+                     test_tape_clear);
 
     return g_test_run ();
 }